@@ -0,0 +1,106 @@
+#include "common.h"
+#include "camera.h"
+
+#define ZOOM_MIN 0.01f
+#define ZOOM_MAX 100.0f
+
+void camera_init(struct camera *cam, enum camera_kind kind, int w, int h)
+{
+    memset(cam, 0, sizeof *cam);
+    cam->kind = kind;
+    cam->zoom = 1.0f;
+    mat4x4_identity(cam->view);
+    cam->view_dirty = 1;
+    camera_set_viewport(cam, w, h);
+}
+
+void camera_set_viewport(struct camera *cam, int w, int h)
+{
+    if (cam->width == w && cam->height == h)
+        return;
+    cam->width = w;
+    cam->height = h;
+    cam->proj_dirty = 1;
+}
+
+void camera_set_pan(struct camera *cam, float x, float y)
+{
+    if (cam->pan[0] == x && cam->pan[1] == y)
+        return;
+    cam->pan[0] = x;
+    cam->pan[1] = y;
+    cam->view_dirty = 1;
+}
+
+void camera_move(struct camera *cam, float dx, float dy)
+{
+    camera_set_pan(cam, cam->pan[0] + dx, cam->pan[1] + dy);
+}
+
+void camera_set_zoom(struct camera *cam, float zoom)
+{
+    if (zoom < ZOOM_MIN)
+        zoom = ZOOM_MIN;
+    if (zoom > ZOOM_MAX)
+        zoom = ZOOM_MAX;
+    if (cam->zoom == zoom)
+        return;
+    cam->zoom = zoom;
+    cam->view_dirty = 1;
+}
+
+static void update_proj(struct camera *cam)
+{
+    if (cam->width < 1 || cam->height < 1){ //instead of dividing by 0
+        mat4x4_identity(cam->proj);
+        return;
+    }
+    if (cam->kind == CAMERA_SCREEN)
+        mat4x4_ortho(cam->proj, 0.0f, cam->width, cam->height, 0.0f, -1.0f, 1.0f);
+    else
+        mat4x4_ortho(cam->proj, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+}
+
+static void update_view(struct camera *cam)
+{
+    //scale about the pan point: view = S(zoom) * T(-pan)
+    mat4x4_identity(cam->view);
+    cam->view[0][0] = cam->zoom;
+    cam->view[1][1] = cam->zoom;
+    cam->view[3][0] = -cam->pan[0] * cam->zoom;
+    cam->view[3][1] = -cam->pan[1] * cam->zoom;
+}
+
+float *camera_matrix(struct camera *cam)
+{
+    if (cam->proj_dirty || cam->view_dirty){
+        if (cam->proj_dirty)
+            update_proj(cam);
+        if (cam->view_dirty)
+            update_view(cam);
+        cam->proj_dirty = 0;
+        cam->view_dirty = 0;
+        mat4x4_mul(cam->viewproj, cam->proj, cam->view);
+        mat4x4_invert(cam->inv_viewproj, cam->viewproj);
+        cam->version++;
+    }
+    return &cam->viewproj[0][0];
+}
+
+void camera_unproject(struct camera *cam, vec2 r, float x, float y)
+{
+    vec4 ndc, out;
+    camera_matrix(cam);
+    if (cam->width < 1 || cam->height < 1){
+        r[0] = x;
+        r[1] = y;
+        return;
+    }
+    ndc[0] = (x / cam->width - 0.5f) * 2.0f;
+    ndc[1] = (y / cam->height - 0.5f) * -2.0f;
+    ndc[2] = 0.0f;
+    ndc[3] = 1.0f;
+    mat4x4_mul_vec4(out, cam->inv_viewproj, ndc);
+    r[0] = out[0];
+    r[1] = out[1];
+}
@@ -0,0 +1,44 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include "lin.h"
+
+/*
+ * owns a projection and a view matrix and caches their product.
+ * nothing is recomputed until the viewport or the camera moves,
+ * camera_matrix() is cheap to call every frame.
+ */
+
+enum camera_kind{
+    CAMERA_SCREEN, //pixels, origin top left, y down (ui)
+    CAMERA_WORLD,  //[-1, 1] on both axes, y up (triangle scenes)
+};
+
+struct camera{
+    enum camera_kind kind;
+    int width;
+    int height;
+    vec2 pan;   //world units, center of the view
+    float zoom; //1.0 shows the whole [-1, 1] range
+
+    char proj_dirty;
+    char view_dirty;
+    unsigned version; //bumped every time viewproj changes
+
+    mat4x4 proj;
+    mat4x4 view;
+    mat4x4 viewproj;
+    mat4x4 inv_viewproj;
+};
+
+void camera_init(struct camera *cam, enum camera_kind kind, int w, int h);
+void camera_set_viewport(struct camera *cam, int w, int h);
+void camera_set_pan(struct camera *cam, float x, float y);
+void camera_move(struct camera *cam, float dx, float dy);
+void camera_set_zoom(struct camera *cam, float zoom);
+//returns the cached proj * view, recomputing it only if something changed
+float *camera_matrix(struct camera *cam);
+//window pixel coordinates -> camera space (world units for CAMERA_WORLD)
+void camera_unproject(struct camera *cam, vec2 r, float x, float y);
+
+#endif
@@ -0,0 +1,405 @@
+#include "common.h"
+#include "capture.h"
+#include "prof.h"
+
+#define STOP_INDEX UINT64_MAX
+
+static uint32_t crc_table[256];
+
+static void crc_init(void)
+{
+    for (uint32_t n = 0; n < 256; n++){
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++)
+            c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[n] = c;
+    }
+}
+
+static uint32_t crc_update(uint32_t crc, const uint8_t *p, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        crc = crc_table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+//chunk data may be written in pieces, the crc covers type + data
+struct chunk{
+    FILE *f;
+    uint32_t crc;
+};
+
+static void chunk_begin(struct chunk *ch, FILE *f, const char *type, uint32_t len)
+{
+    uint8_t hdr[8];
+    put_be32(hdr, len);
+    memcpy(hdr + 4, type, 4);
+    fwrite(hdr, 1, 8, f);
+    ch->f = f;
+    ch->crc = crc_update(0xFFFFFFFFu, hdr + 4, 4);
+}
+
+static void chunk_write(struct chunk *ch, const uint8_t *p, size_t n)
+{
+    fwrite(p, 1, n, ch->f);
+    ch->crc = crc_update(ch->crc, p, n);
+}
+
+static void chunk_end(struct chunk *ch)
+{
+    uint8_t crc[4];
+    put_be32(crc, ch->crc ^ 0xFFFFFFFFu);
+    fwrite(crc, 1, 4, ch->f);
+}
+
+//RGB8 with filter 0 rows and stored deflate blocks: no zlib dependency and
+//the encoder stays far cheaper than the frame rate. files are ~w*h*3 bytes.
+static int write_png(struct capture *c, const char *name, const uint8_t *rgba)
+{
+    static const uint8_t sig[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+    int w = c->width, h = c->height;
+    size_t row = 1 + (size_t) w * 3;
+    size_t raw = row * h;
+    uint8_t *buf = c->scratch;
+
+    uint32_t a = 1, b = 0;
+    for (int y = 0; y < h; y++){
+        uint8_t *out = buf + row * y;
+        const uint8_t *in = rgba + (size_t) w * 4 * y;
+        *out++ = 0;
+        for (int x = 0; x < w; x++){
+            out[0] = in[0];
+            out[1] = in[1];
+            out[2] = in[2];
+            out += 3;
+            in += 4;
+        }
+    }
+    //adler32, with the modulo deferred as far as it can go
+    for (size_t i = 0; i < raw; ){
+        size_t n = raw - i < 5552 ? raw - i : 5552;
+        for (size_t e = i + n; i < e; i++){
+            a += buf[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+
+    FILE *f = fopen(name, "wb");
+    if (!f)
+        return -1;
+    fwrite(sig, 1, sizeof sig, f);
+
+    struct chunk ch;
+    uint8_t ihdr[13];
+    put_be32(ihdr, w);
+    put_be32(ihdr + 4, h);
+    ihdr[8] = 8;  //bit depth
+    ihdr[9] = 2;  //truecolor
+    ihdr[10] = ihdr[11] = ihdr[12] = 0;
+    chunk_begin(&ch, f, "IHDR", sizeof ihdr);
+    chunk_write(&ch, ihdr, sizeof ihdr);
+    chunk_end(&ch);
+
+    size_t blocks = raw ? (raw + 65534) / 65535 : 1;
+    chunk_begin(&ch, f, "IDAT", 2 + raw + blocks * 5 + 4);
+    chunk_write(&ch, (const uint8_t []){0x78, 0x01}, 2);
+    for (size_t i = 0; i < blocks; i++){
+        size_t off = i * 65535;
+        uint16_t len = raw - off < 65535 ? raw - off : 65535;
+        uint8_t hdr[5] = {i + 1 == blocks, len & 0xFF, len >> 8, ~len & 0xFF, (~len >> 8) & 0xFF};
+        chunk_write(&ch, hdr, 5);
+        chunk_write(&ch, buf + off, len);
+    }
+    uint8_t adler[4];
+    put_be32(adler, (b << 16) | a);
+    chunk_write(&ch, adler, 4);
+    chunk_end(&ch);
+
+    chunk_begin(&ch, f, "IEND", 0);
+    chunk_end(&ch);
+    int err = ferror(f);
+    if (fclose(f) != 0 || err)
+        return -1;
+    return 0;
+}
+
+//full range BT.601 (C420jpeg), chroma is the average of each 2x2 block
+static int write_y4m(struct capture *c, const uint8_t *rgba)
+{
+    int w = c->width, h = c->height;
+    int cw = (w + 1) / 2, ch = (h + 1) / 2;
+    uint8_t *py = c->scratch, *pu = py + (size_t) w * h, *pv = pu + (size_t) cw * ch;
+
+    for (int i = 0; i < w * h; i++){
+        const uint8_t *p = rgba + (size_t) i * 4;
+        py[i] = (77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8;
+    }
+    for (int y = 0; y < ch; y++){
+        for (int x = 0; x < cw; x++){
+            int r = 0, g = 0, b = 0, n = 0;
+            for (int dy = 0; dy < 2 && 2 * y + dy < h; dy++){
+                for (int dx = 0; dx < 2 && 2 * x + dx < w; dx++){
+                    const uint8_t *p = rgba + ((size_t) (2 * y + dy) * w + 2 * x + dx) * 4;
+                    r += p[0];
+                    g += p[1];
+                    b += p[2];
+                    n++;
+                }
+            }
+            pu[y * cw + x] = 128 + (-43 * r - 85 * g + 128 * b) / (256 * n);
+            pv[y * cw + x] = 128 + (128 * r - 107 * g - 21 * b) / (256 * n);
+        }
+    }
+    fputs("FRAME\n", c->y4m);
+    fwrite(c->scratch, 1, (size_t) w * h + 2 * (size_t) cw * ch, c->y4m);
+    return ferror(c->y4m) ? -1 : 0;
+}
+
+static int encoder(void *arg)
+{
+    struct capture *c = arg;
+    char name[300];
+    prof_thread_name("capture");
+    for (;;){
+        SDL_SemWait(c->filled);
+        struct capture_frame *f = &c->pool[c->pool_tail];
+        c->pool_tail = (c->pool_tail + 1) % CAPTURE_POOL;
+        if (f->index == STOP_INDEX)
+            break;
+        if (!c->failed){
+            PROF_ZONE("encode");
+            int s;
+            if (c->format == CAPTURE_Y4M){
+                s = write_y4m(c, f->rgba);
+            }
+            else {
+                snprintf(name, sizeof name, c->path, (int) f->index);
+                s = write_png(c, name, f->rgba);
+            }
+            if (s < 0){
+                c->failed = 1;
+                c->last_error = "capture: write failed";
+            }
+            else {
+                c->written++;
+            }
+        }
+        SDL_SemPost(c->free_slots);
+    }
+    return 0;
+}
+
+static void release(struct capture *c)
+{
+    for (int i = 0; i < CAPTURE_POOL; i++)
+        free(c->pool[i].rgba);
+    free(c->scratch);
+    if (c->free_slots)
+        SDL_DestroySemaphore(c->free_slots);
+    if (c->filled)
+        SDL_DestroySemaphore(c->filled);
+    if (c->y4m)
+        fclose(c->y4m);
+    c->y4m = NULL;
+    c->scratch = NULL;
+    c->free_slots = c->filled = NULL;
+    for (int i = 0; i < CAPTURE_POOL; i++)
+        c->pool[i].rgba = NULL;
+}
+
+int capture_start(struct capture *c, const char *path, int w, int h, int fps, int gl)
+{
+    memset(c, 0, sizeof *c);
+    if (w < 1 || h < 1 || !path){
+        c->last_error = "capture: bad size or path";
+        return -1;
+    }
+    if (!crc_table[1])
+        crc_init();
+    c->width = w;
+    c->height = h;
+    c->fps = fps > 0 ? fps : 60;
+    c->gl = gl;
+
+    size_t len = strlen(path);
+    if (len > 4 && strcmp(path + len - 4, ".y4m") == 0){
+        c->format = CAPTURE_Y4M;
+        snprintf(c->path, sizeof c->path, "%s", path);
+    }
+    else {
+        c->format = CAPTURE_PNG;
+        //the pattern goes to snprintf on the encoder thread, one conversion only
+        const char *pct = strchr(path, '%');
+        if (!pct)
+            snprintf(c->path, sizeof c->path, "%s%%05d.png", path);
+        else if (strchr(pct + 1, '%') || pct[strspn(pct + 1, "0123456789") + 1] != 'd'){
+            c->last_error = "capture: PNG pattern takes a single %05d-style conversion";
+            return -1;
+        }
+        else
+            snprintf(c->path, sizeof c->path, "%s", path);
+    }
+
+    size_t frame = (size_t) w * h * 4;
+    size_t scratch = (size_t) (1 + w * 3) * h;
+    for (int i = 0; i < CAPTURE_POOL; i++){
+        c->pool[i].rgba = malloc(frame);
+        if (!c->pool[i].rgba)
+            goto fail;
+    }
+    c->scratch = malloc(scratch);
+    c->free_slots = SDL_CreateSemaphore(CAPTURE_POOL);
+    c->filled = SDL_CreateSemaphore(0);
+    if (!c->scratch || !c->free_slots || !c->filled)
+        goto fail;
+
+    if (c->format == CAPTURE_Y4M){
+        c->y4m = fopen(c->path, "wb");
+        if (!c->y4m){
+            c->last_error = "capture: cannot open output";
+            goto fail;
+        }
+        fprintf(c->y4m, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", w, h, c->fps);
+    }
+
+    if (gl){
+        glGenBuffers(CAPTURE_RING, c->pbo);
+        for (int i = 0; i < CAPTURE_RING; i++){
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, c->pbo[i]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, frame, NULL, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    c->thread = SDL_CreateThread(encoder, "capture", c);
+    if (!c->thread)
+        goto fail;
+    c->active = 1;
+    return 0;
+fail:
+    if (!c->last_error)
+        c->last_error = "capture: out of memory";
+    if (c->gl && c->pbo[0])
+        glDeleteBuffers(CAPTURE_RING, c->pbo);
+    release(c);
+    return -1;
+}
+
+//copies rows into a free pool slot, flipping when the source is bottom up
+static void submit(struct capture *c, const uint8_t *src, int stride, int bottom_up, uint64_t index)
+{
+    if (c->lossless)
+        SDL_SemWait(c->free_slots);
+    else if (SDL_SemTryWait(c->free_slots) != 0){
+        c->dropped++;
+        return;
+    }
+    struct capture_frame *f = &c->pool[c->pool_head];
+    size_t row = (size_t) c->width * 4;
+    for (int y = 0; y < c->height; y++){
+        int sy = bottom_up ? c->height - 1 - y : y;
+        memcpy(f->rgba + row * y, src + (size_t) stride * sy, row);
+    }
+    f->index = index;
+    c->pool_head = (c->pool_head + 1) % CAPTURE_POOL;
+    SDL_SemPost(c->filled);
+}
+
+//maps the oldest pack buffer once it is done, wait forces it. -1 while it
+//is not, unless drop gives the frame up instead
+static int collect(struct capture *c, int wait, int drop)
+{
+    int i = (c->ring_head - c->ring_pending + CAPTURE_RING) % CAPTURE_RING;
+    GLenum s = glClientWaitSync(c->fence[i], wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                wait ? 1000000000ull : 0);
+    if (s == GL_TIMEOUT_EXPIRED && !drop)
+        return -1;
+    glDeleteSync(c->fence[i]);
+    c->fence[i] = 0;
+    c->ring_pending--;
+    //a hung gpu or a lost context, the buffer is never mapped
+    if (s == GL_TIMEOUT_EXPIRED || s == GL_WAIT_FAILED){
+        c->dropped++;
+        return 0;
+    }
+
+    size_t size = (size_t) c->width * c->height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, c->pbo[i]);
+    const uint8_t *p = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (p){
+        submit(c, p, c->width * 4, 1, c->ring_index[i]);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else {
+        c->dropped++;
+    }
+    return 0;
+}
+
+void capture_frame_gl(struct capture *c)
+{
+    if (!c->active || !c->gl)
+        return;
+    //whatever finished since last frame, and make room if the ring is full
+    while (c->ring_pending > 0 && collect(c, c->ring_pending == CAPTURE_RING, 0) == 0)
+        ;
+    if (c->ring_pending == CAPTURE_RING){
+        c->dropped++;
+        c->frames++;
+        return;
+    }
+
+    int i = c->ring_head;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, c->pbo[i]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, c->width, c->height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    c->fence[i] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    c->ring_index[i] = c->frames++;
+    c->ring_head = (i + 1) % CAPTURE_RING;
+    c->ring_pending++;
+}
+
+void capture_frame_rgba(struct capture *c, const uint8_t *rgba, int stride)
+{
+    if (!c->active)
+        return;
+    submit(c, rgba, stride, 0, c->frames++);
+}
+
+void capture_stop(struct capture *c)
+{
+    if (!c->active)
+        return;
+    if (c->gl){
+        //one wait per frame at most, a timed out one is dropped
+        while (c->ring_pending > 0)
+            collect(c, 1, 1);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glDeleteBuffers(CAPTURE_RING, c->pbo);
+    }
+
+    //the stop marker queues behind every submitted frame
+    SDL_SemWait(c->free_slots);
+    c->pool[c->pool_head].index = STOP_INDEX;
+    c->pool_head = (c->pool_head + 1) % CAPTURE_POOL;
+    SDL_SemPost(c->filled);
+    SDL_WaitThread(c->thread, NULL);
+    c->thread = NULL;
+
+    fprintf(stderr, "capture: %lu frames, %lu written, %lu dropped%s%s\n",
+            (unsigned long) c->frames, (unsigned long) c->written, (unsigned long) c->dropped,
+            c->last_error ? ", " : "", c->last_error ? c->last_error : "");
+    release(c);
+    c->active = 0;
+}
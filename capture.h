@@ -0,0 +1,75 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <SDL.h>
+#include "glad/glad.h"
+
+/*
+ * records frames to disk without stalling the renderer.
+ * the GL path reads the back buffer into a ring of pixel pack buffers and
+ * only maps one after its fence signaled, a few frames later. mapped frames
+ * are copied into a fixed pool and a background thread writes them out, as
+ * a numbered PNG sequence or a single raw Y4M (4:2:0) stream.
+ * the size is fixed at start, frames arriving while the pool is full are
+ * dropped and counted unless lossless is set.
+ */
+
+#define CAPTURE_RING 3  //pack buffers in flight
+#define CAPTURE_POOL 8  //frames waiting for the encoder
+
+enum capture_format{
+    CAPTURE_PNG,
+    CAPTURE_Y4M,
+};
+
+struct capture_frame{
+    uint8_t *rgba;   //w*h*4, top row first
+    uint64_t index;
+};
+
+struct capture{
+    int active;
+    int gl;           //frames come from pack buffers
+    int lossless;     //wait for the encoder instead of dropping, for unpaced runs
+    enum capture_format format;
+    int width;
+    int height;
+    int fps;
+    char path[256];  //printf pattern for PNG, file name for Y4M
+    FILE *y4m;
+
+    GLuint pbo[CAPTURE_RING];
+    GLsync fence[CAPTURE_RING];
+    uint64_t ring_index[CAPTURE_RING];
+    int ring_head;    //next pbo to read into
+    int ring_pending; //reads issued but not yet copied out
+
+    struct capture_frame pool[CAPTURE_POOL];
+    int pool_head;   //main thread fills
+    int pool_tail;   //encoder drains
+    SDL_sem *free_slots;
+    SDL_sem *filled;
+    SDL_Thread *thread;
+    uint8_t *scratch; //encoder side: png rows / yuv planes
+
+    uint64_t frames;  //handed to the capture
+    uint64_t written;
+    uint64_t dropped;
+    int failed;       //encoder hit an i/o error, stops writing
+    const char *last_error;
+};
+
+//path ending in .y4m writes a stream, anything else is a PNG pattern:
+//"shots/f%05d.png", or a prefix that gets "%05d.png" appended.
+//gl != 0 creates the pack buffers, so a context must be current.
+int  capture_start(struct capture *c, const char *path, int w, int h, int fps, int gl);
+//after drawing, before the swap. reads the bound read buffer.
+void capture_frame_gl(struct capture *c);
+//already in memory, e.g. the software rasterizer. stride in bytes
+void capture_frame_rgba(struct capture *c, const uint8_t *rgba, int stride);
+//drains pending reads, joins the encoder and closes the output
+void capture_stop(struct capture *c);
+
+#endif
@@ -7,10 +7,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "log.h"
 
 
-static void die(const char *msg, ...){
-    
+static inline void die(const char *msg, ...){
+    //what the log writer still has queued goes out before the reason
+    log_stop();
     va_list va;
     va_start(va, msg);
     vfprintf(stderr, msg, va);
@@ -20,21 +22,13 @@ static void die(const char *msg, ...){
     exit(1);
 }
 
-static void dlogf(char *msg, ...){
-    
-    va_list va;
-    va_start(va, msg);
-    vfprintf(stderr, msg, va);
-    va_end(va);
-}
-
-static const char *lfcat(const char *f, int l){
-    static char buff[1024];
-    snprintf(buff, 1024-1, "%s:%d", f, l);
-    return buff;
-}
+//deferred, see log.h. the format has to be a literal
+#define dlogf(...) LOG_DEBUG(__VA_ARGS__)
 
-#define LINEFILESTR lfcat(__FILE__, __LINE__)
+#define STR_(x) #x
+#define STR(x) STR_(x)
+//a literal, safe to keep by pointer or log
+#define LINEFILESTR (__FILE__ ":" STR(__LINE__))
 
 
 #endif
@@ -0,0 +1,135 @@
+#include <SDL.h>
+#include "common.h"
+#include "glad/glad.h"
+#include "errcheck.h"
+
+void check_sdl(const char *where)
+{
+    const char *m = SDL_GetError();
+    if (m && *m){
+        LOG_ERROR("sdl: %s at %s\n", m, where);
+        SDL_ClearError();
+    }
+}
+
+#ifndef NDEBUG
+
+#include "check_gl.h"
+
+#define GL_DEBUG_OUTPUT_                0x92E0
+#define GL_DEBUG_TYPE_ERROR_            0x824C
+#define GL_DEBUG_SEVERITY_HIGH_         0x9146
+#define GL_DEBUG_SEVERITY_MEDIUM_       0x9147
+#define GL_DEBUG_SEVERITY_NOTIFICATION_ 0x826B
+#define GL_CONTEXT_FLAG_DEBUG_BIT_      0x0002
+
+typedef void (APIENTRY *debug_proc)(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                    GLsizei length, const GLchar *message, const void *user);
+typedef void (APIENTRYP PFNDEBUGMESSAGECALLBACK)(debug_proc callback, const void *user);
+
+static enum errcheck_mode mode;
+static void *checkpoint; //last check_gl() on the gl thread, read by the callback
+
+static int has_extension(const char *name)
+{
+    GLint n = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+    for (GLint i = 0; i < n; i++){
+        const char *e = (const char *) glGetStringi(GL_EXTENSIONS, i);
+        if (e && strcmp(e, name) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+//a record copies LOG_TEXT bytes of strings, longer driver messages go out
+//in pieces of their own
+static void log_gl(int level, const char *message, const char *where)
+{
+    if (level < LOG_MIN_LEVEL)
+        return;
+    size_t len = strlen(message);
+    if (len + strlen(where) + 2 <= LOG_TEXT){
+        LOG_AT(level, "gl: %s (after %s)\n", message, where);
+        return;
+    }
+    char piece[LOG_TEXT];
+    for (size_t at = 0; at < len; at += sizeof piece - 1){
+        size_t n = len - at < sizeof piece - 1 ? len - at : sizeof piece - 1;
+        memcpy(piece, message + at, n);
+        piece[n] = 0;
+        LOG_AT(level, at ? "    %s\n" : "gl: %s\n", piece);
+    }
+    LOG_AT(level, "    (after %s)\n", where);
+}
+
+//may run on a driver thread
+static void APIENTRY on_debug(GLenum source, GLenum type, GLuint id, GLenum severity,
+                              GLsizei length, const GLchar *message, const void *user)
+{
+    (void) source; (void) id; (void) length; (void) user;
+    const char *where = SDL_AtomicGetPtr(&checkpoint);
+    if (!where)
+        where = "start";
+    if (type == GL_DEBUG_TYPE_ERROR_)
+        log_gl(LOG_LEVEL_ERROR, message, where);
+    else if (severity == GL_DEBUG_SEVERITY_HIGH_ || severity == GL_DEBUG_SEVERITY_MEDIUM_)
+        log_gl(LOG_LEVEL_WARN, message, where);
+    else if (severity != GL_DEBUG_SEVERITY_NOTIFICATION_)
+        log_gl(LOG_LEVEL_DEBUG, message, where);
+}
+
+static void drain_errors(const char *where, const char *how)
+{
+    GLenum e;
+    //at most a few, a lost context can keep returning errors
+    for (int i = 0; i < 8 && (e = glGetError()) != GL_NO_ERROR; i++){
+        const char *desc;
+        const char *name = gl_error_name(e, &desc);
+        LOG_ERROR("gl: %s, %s\n    %s %s\n", name, desc, how, where);
+    }
+}
+
+enum errcheck_mode errcheck_init(void *(*get_proc)(const char *))
+{
+    const char *env = getenv("GLERR_SYNC");
+    if (env && *env == '1')
+        return mode = ERRCHECK_SYNC;
+
+    PFNDEBUGMESSAGECALLBACK set_callback = NULL;
+    int khr = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 3) ||
+              has_extension("GL_KHR_debug");
+    //ARB only reports from debug contexts, and SDL may have handed out a
+    //plain one without saying so
+    GLint flags = 0;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+    //the dlsym idiom, ISO C has no object to function pointer cast
+    if (khr)
+        *(void **) &set_callback = get_proc("glDebugMessageCallback");
+    else if (flags & GL_CONTEXT_FLAG_DEBUG_BIT_ && has_extension("GL_ARB_debug_output"))
+        *(void **) &set_callback = get_proc("glDebugMessageCallbackARB");
+    drain_errors("before errcheck_init", "at");
+    if (!set_callback)
+        return mode = ERRCHECK_SAMPLED;
+    set_callback(on_debug, NULL);
+    //on in debug contexts already, ARB has no switch
+    if (khr)
+        glEnable(GL_DEBUG_OUTPUT_);
+    return mode = ERRCHECK_DEBUG_OUTPUT;
+}
+
+void errcheck_gl(const char *where)
+{
+    if (mode == ERRCHECK_SYNC)
+        drain_errors(where, "at");
+    else
+        SDL_AtomicSetPtr(&checkpoint, (void *) where);
+}
+
+void errcheck_frame(void)
+{
+    if (mode == ERRCHECK_SAMPLED)
+        drain_errors(SDL_AtomicGetPtr(&checkpoint), "this frame, last check");
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef ERRCHECK_H
+#define ERRCHECK_H
+
+/*
+ * gl and sdl error reports without stalls or allocations, through the
+ * logger so any thread can report. with KHR_debug or ARB_debug_output
+ * the driver calls back with its message and check_gl() only notes where
+ * the frame is, for the report. without them gl errors are sampled once
+ * per frame by errcheck_frame(). GLERR_SYNC=1 in the environment, or not
+ * calling errcheck_init() at all, gives the old glGetError per check.
+ * NDEBUG builds compile the gl side out completely.
+ */
+
+enum errcheck_mode{
+    ERRCHECK_SYNC,         //glGetError in every check_gl()
+    ERRCHECK_DEBUG_OUTPUT, //driver callback
+    ERRCHECK_SAMPLED,      //glGetError once per frame
+    ERRCHECK_OFF,
+};
+
+//logs and clears SDL's error string for this thread, if there is one
+void check_sdl(const char *where);
+
+#ifdef NDEBUG
+
+#define check_gl(where) ((void) 0)
+#define errcheck_init(get_proc) (ERRCHECK_OFF)
+#define errcheck_frame() ((void) 0)
+
+#else
+
+//a GL context must be current
+enum errcheck_mode errcheck_init(void *(*get_proc)(const char *));
+//where has to outlive the frame, LINEFILESTR does
+void errcheck_gl(const char *where);
+void errcheck_frame(void);
+#define check_gl(where) errcheck_gl(where)
+
+#endif
+
+#endif
@@ -0,0 +1,148 @@
+#include "common.h"
+#include "gfx.h"
+#include "checks.h"
+
+int gfx_init(struct gfx *g, const char *title, int w, int h, unsigned flags)
+{
+    memset(g, 0, sizeof *g);
+    g->w = w;
+    g->h = h;
+    g->errors = ERRCHECK_OFF;
+    if (!(flags & GFX_WINDOW))
+        return 0;
+
+    if (flags & GFX_GL){
+        SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
+        SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+        SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, flags & GFX_DEBUG_GL ? SDL_GL_CONTEXT_DEBUG_FLAG : 0);
+        SDL_GL_LoadLibrary(NULL);
+    }
+    g->window = SDL_CreateWindow(title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, w, h,
+                                 (flags & GFX_GL ? SDL_WINDOW_OPENGL : 0) |
+                                 (flags & GFX_HIDDEN ? SDL_WINDOW_HIDDEN : 0));
+    if (!g->window){
+        g->last_error = "no window";
+        return -1;
+    }
+    SDL_GetWindowSize(g->window, &g->w, &g->h);
+    if (!(flags & GFX_GL))
+        return 0;
+
+    g->gl = SDL_GL_CreateContext(g->window);
+    if (!g->gl){
+        g->last_error = "no gl";
+        gfx_free(g);
+        return -1;
+    }
+    if (!gladLoadGLLoader(SDL_GL_GetProcAddress)){
+        g->last_error = "gladLoadGLLoader failed";
+        gfx_free(g);
+        return -1;
+    }
+    g->errors = errcheck_init(SDL_GL_GetProcAddress);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glViewport(0, 0, g->w, g->h);
+    return 0;
+}
+
+void gfx_free(struct gfx *g)
+{
+    if (g->gl)
+        SDL_GL_DeleteContext(g->gl);
+    if (g->window)
+        SDL_DestroyWindow(g->window);
+    g->gl = NULL;
+    g->window = NULL;
+}
+
+int gfx_make_current(struct gfx *g)
+{
+    if (!g->gl)
+        return 0;
+    if (SDL_GL_MakeCurrent(g->window, g->gl) < 0){
+        g->last_error = SDL_GetError();
+        return -1;
+    }
+    return 0;
+}
+
+int gfx_program(GLuint *prg, const char *vsh_src, const char *fsh_src, const char **err)
+{
+    GLuint p = glCreateProgram();
+    if (!p){
+        *err = "glCreateProgram failed";
+        return -1;
+    }
+    GLuint vsh = glCreateShader(GL_VERTEX_SHADER);
+    GLuint fsh = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(vsh, 1, &vsh_src, NULL);
+    glShaderSource(fsh, 1, &fsh_src, NULL);
+    glCompileShader(vsh);
+    glCompileShader(fsh);
+    GLint status;
+    const char *log = NULL;
+    glGetShaderiv(vsh, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE)
+        log = shader_log(vsh);
+    glGetShaderiv(fsh, GL_COMPILE_STATUS, &status);
+    if (!log && status != GL_TRUE)
+        log = shader_log(fsh);
+    if (!log){
+        glAttachShader(p, vsh);
+        glAttachShader(p, fsh);
+    }
+    //attached shaders go away with the program
+    glDeleteShader(vsh);
+    glDeleteShader(fsh);
+    if (!log){
+        glLinkProgram(p);
+        glGetProgramiv(p, GL_LINK_STATUS, &status);
+        if (status != GL_TRUE)
+            log = prog_log(p);
+    }
+    if (log){
+        glDeleteProgram(p);
+        *err = log;
+        return -1;
+    }
+    *prg = p;
+    return 0;
+}
+
+int gfx_stream_init(struct gfx_stream *s, size_t cap)
+{
+    s->uploaded = 0;
+    glGenBuffers(1, &s->vbo);
+    if (!s->vbo)
+        return -1;
+    gfx_stream_resize(s, cap);
+    return 0;
+}
+
+void gfx_stream_resize(struct gfx_stream *s, size_t cap)
+{
+    s->cap = cap;
+    glBindBuffer(GL_ARRAY_BUFFER, s->vbo);
+    glBufferData(GL_ARRAY_BUFFER, cap, NULL, GL_DYNAMIC_DRAW);
+}
+
+void gfx_stream_free(struct gfx_stream *s)
+{
+    if (s->vbo)
+        glDeleteBuffers(1, &s->vbo);
+    s->vbo = 0;
+}
+
+int gfx_stream_update(struct gfx_stream *s, size_t first, size_t len, const void *data)
+{
+    if (first > s->cap || len > s->cap - first)
+        return -1;
+    glBindBuffer(GL_ARRAY_BUFFER, s->vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, first, len, data);
+    s->uploaded += len;
+    return 0;
+}
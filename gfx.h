@@ -0,0 +1,57 @@
+#ifndef GFX_H
+#define GFX_H
+
+#include <stddef.h>
+#include <SDL.h>
+#include "glad/glad.h"
+#include "errcheck.h"
+
+/*
+ * the window and GL setup every demo did in main(), plus shader building
+ * and the dynamic vertex buffer tri2 streams triangles through. all state
+ * lives in the structs, so one process can hold several windows each with
+ * its own context; gfx_make_current() before touching another one's GL
+ * objects. the glad pointers are process wide, loaded by the first
+ * context, which is fine as long as every context comes from one driver.
+ * log, prof and errcheck stay per process.
+ */
+
+#define GFX_WINDOW   1 //create a window, without it nothing is created
+#define GFX_GL       2 //and a GL 3.2 context for it, made current
+#define GFX_DEBUG_GL 4 //a debug context, errcheck reports through it
+#define GFX_HIDDEN   8 //never shown, for a context without anything on screen
+
+struct gfx{
+    SDL_Window *window;
+    SDL_GLContext gl;
+    int w, h;                  //drawable size after gfx_init
+    enum errcheck_mode errors; //how gl errors are reported
+    const char *last_error;
+};
+
+//a vertex buffer sized once, frames upload only what changed
+struct gfx_stream{
+    GLuint vbo;
+    size_t cap;
+    size_t uploaded;           //bytes through gfx_stream_update, callers reset it
+};
+
+//zeroes g, then creates what flags ask for. -1 and last_error on failure,
+//with whatever was created already freed
+int  gfx_init(struct gfx *g, const char *title, int w, int h, unsigned flags);
+void gfx_free(struct gfx *g);
+int  gfx_make_current(struct gfx *g);
+
+//vertex and fragment shader from source, linked. on failure *err is the
+//compile or link log, valid until the next call from the same thread
+int  gfx_program(GLuint *prg, const char *vsh_src, const char *fsh_src, const char **err);
+
+//creates and sizes the buffer, leaves it bound to GL_ARRAY_BUFFER
+int  gfx_stream_init(struct gfx_stream *s, size_t cap);
+//same buffer name, so vertex array bindings stay valid. contents are lost
+void gfx_stream_resize(struct gfx_stream *s, size_t cap);
+void gfx_stream_free(struct gfx_stream *s);
+//uploads [first, first + len) of the buffer's contents from data, -1 past cap
+int  gfx_stream_update(struct gfx_stream *s, size_t first, size_t len, const void *data);
+
+#endif
@@ -0,0 +1,114 @@
+#include "common.h"
+#include "gputime.h"
+#include "prof.h"
+
+#ifndef GL_TIMESTAMP
+#define GL_TIMESTAMP 0x8E28
+#endif
+
+#define N_QUERIES (GPUTIME_FRAMES * GPUTIME_PASSES * 2)
+
+int gputime_init(struct gputime *g, void *(*get_proc)(const char *))
+{
+    memset(g, 0, sizeof *g);
+    g->open = -1;
+    //GL 3.3 / ARB_timer_query, past what glad loads. glx hands out a
+    //pointer for any name, only the counter bits tell support apart
+    *(void **) &g->query_counter = get_proc("glQueryCounter");
+    *(void **) &g->get_ui64 = get_proc("glGetQueryObjectui64v");
+    if (!g->query_counter || !g->get_ui64){
+        g->last_error = "no timer queries";
+        return -1;
+    }
+    //earlier errors would fail the probe, a lost context keeps returning them
+    for (int i = 0; i < 8 && glGetError() != GL_NO_ERROR; i++)
+        ;
+    GLint bits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+    if (glGetError() != GL_NO_ERROR || bits == 0){
+        g->last_error = "no timer queries";
+        return -1;
+    }
+    glGenQueries(N_QUERIES, &g->queries[0][0][0]);
+    g->ok = 1;
+    return 0;
+}
+
+void gputime_free(struct gputime *g)
+{
+    if (g->ok)
+        glDeleteQueries(N_QUERIES, &g->queries[0][0][0]);
+    g->ok = 0;
+}
+
+int gputime_add_pass(struct gputime *g, const char *name)
+{
+    if (g->n_passes == GPUTIME_PASSES)
+        return -1;
+    g->names[g->n_passes] = name;
+    return g->n_passes++;
+}
+
+void gputime_begin(struct gputime *g, int pass)
+{
+    if (!g->ok || pass < 0 || g->open >= 0)
+        return;
+    g->query_counter(g->queries[g->slot][pass][0], GL_TIMESTAMP);
+    g->open = pass;
+}
+
+void gputime_end(struct gputime *g)
+{
+    if (g->open < 0)
+        return;
+    g->query_counter(g->queries[g->slot][g->open][1], GL_TIMESTAMP);
+    g->pending[g->slot][g->open] = 1;
+    g->open = -1;
+}
+
+void gputime_frame(struct gputime *g)
+{
+    if (!g->ok)
+        return;
+    //oldest slot first, so last_ms ends up with the newest result
+    for (int k = 1; k <= GPUTIME_FRAMES; k++){
+        int s = (g->slot + k) % GPUTIME_FRAMES;
+        for (int p = 0; p < g->n_passes; p++){
+            if (!g->pending[s][p])
+                continue;
+            //the end stamp was issued last, once it is there both are
+            GLuint ready = 0;
+            glGetQueryObjectuiv(g->queries[s][p][1], GL_QUERY_RESULT_AVAILABLE, &ready);
+            if (!ready)
+                continue;
+            GLuint64 t0 = 0, t1 = 0;
+            g->get_ui64(g->queries[s][p][0], GL_QUERY_RESULT, &t0);
+            g->get_ui64(g->queries[s][p][1], GL_QUERY_RESULT, &t1);
+            prof_gpu_push(g->names[p], t0, t1);
+            g->pending[s][p] = 0;
+            g->last_ms[p] = (t1 - t0) / 1e6f;
+            g->sum_ms[p] += g->last_ms[p];
+            g->samples[p]++;
+        }
+    }
+    g->slot = (g->slot + 1) % GPUTIME_FRAMES;
+    for (int p = 0; p < g->n_passes; p++){
+        if (g->pending[g->slot][p]){
+            g->pending[g->slot][p] = 0;
+            g->dropped++;
+        }
+    }
+}
+
+float gputime_avg_ms(const struct gputime *g, int pass)
+{
+    if (pass < 0 || !g->samples[pass])
+        return 0.0f;
+    return g->sum_ms[pass] / g->samples[pass];
+}
+
+void gputime_reset(struct gputime *g)
+{
+    memset(g->sum_ms, 0, sizeof g->sum_ms);
+    memset(g->samples, 0, sizeof g->samples);
+}
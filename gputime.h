@@ -0,0 +1,52 @@
+#ifndef GPUTIME_H
+#define GPUTIME_H
+
+#include <stdint.h>
+#include "glad/glad.h"
+
+/*
+ * gpu time per render pass, always on. every pass gets a pair of
+ * GL_TIMESTAMP queries per frame slot, slots are reused GPUTIME_FRAMES
+ * frames later. results are only read once the driver says they are
+ * available, so nothing here ever waits on the gpu. a slot that comes
+ * around again with a result still missing counts as dropped. one pass is
+ * open at a time. with make PROF=1 the results also go on prof's gpu track,
+ * so passes timed here need no PROF_GPU_ZONE of their own.
+ */
+
+#define GPUTIME_PASSES 4
+#define GPUTIME_FRAMES 4
+
+struct gputime{
+    int ok;            //the driver has timer queries
+    void (APIENTRYP query_counter)(GLuint id, GLenum target);
+    void (APIENTRYP get_ui64)(GLuint id, GLenum pname, GLuint64 *params);
+    int n_passes;
+    const char *names[GPUTIME_PASSES];
+    GLuint queries[GPUTIME_FRAMES][GPUTIME_PASSES][2]; //begin and end stamps
+    char pending[GPUTIME_FRAMES][GPUTIME_PASSES];
+    int slot;          //frame slot being recorded
+    int open;          //pass inside a query, -1 when none
+
+    float last_ms[GPUTIME_PASSES]; //newest result
+    double sum_ms[GPUTIME_PASSES]; //since gputime_reset()
+    int samples[GPUTIME_PASSES];
+    uint64_t dropped;
+    const char *last_error;
+};
+
+//a GL context must be current, get_proc loads the GL 3.3 timer query
+//calls. returns -1 without them, every other call is then a no-op
+int  gputime_init(struct gputime *g, void *(*get_proc)(const char *));
+void gputime_free(struct gputime *g);
+//returns the pass index, or -1 when GPUTIME_PASSES are taken
+int  gputime_add_pass(struct gputime *g, const char *name);
+void gputime_begin(struct gputime *g, int pass);
+void gputime_end(struct gputime *g);
+//once per frame after the last pass: reads what is ready, moves to the next slot
+void gputime_frame(struct gputime *g);
+//mean of the results since the last reset, 0 when there were none
+float gputime_avg_ms(const struct gputime *g, int pass);
+void gputime_reset(struct gputime *g);
+
+#endif
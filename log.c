@@ -0,0 +1,256 @@
+#include <ctype.h>
+#include <SDL.h>
+#include "common.h"
+#include "log.h"
+
+struct log_ring{
+    struct log_ring *next;
+    SDL_atomic_t head;   //owning thread
+    SDL_atomic_t tail;   //writer
+    SDL_atomic_t dropped;
+    struct log_record rec[LOG_RING];
+};
+
+static struct {
+    int active;
+    FILE *out;
+    int min_level;
+    struct log_ring *rings; //push only, linked with CAS
+    SDL_sem *wake;
+    SDL_Thread *thread;
+    SDL_atomic_t quit;
+} lg;
+
+static _Thread_local struct log_ring *self;
+
+static struct log_ring *own_ring(void)
+{
+    if (self)
+        return self;
+    struct log_ring *r = calloc(1, sizeof *r);
+    if (!r)
+        return NULL;
+    do {
+        r->next = SDL_AtomicGetPtr((void **) &lg.rings);
+    } while (!SDL_AtomicCASPtr((void **) &lg.rings, r->next, r));
+    return self = r;
+}
+
+//copies args into the record, string contents included
+static void fill(struct log_record *r, int level, const char *fmt, int nargs, const struct log_arg *args)
+{
+    int text = 0;
+    r->fmt = fmt;
+    r->time = SDL_GetPerformanceCounter();
+    r->level = level;
+    r->nargs = nargs < LOG_ARGS_MAX ? nargs : LOG_ARGS_MAX;
+    for (int i = 0; i < r->nargs; i++){
+        r->args[i] = args[i];
+        if (args[i].type != LOG_ARG_STR)
+            continue;
+        const char *s = args[i].s ? args[i].s : "(null)";
+        int len = strlen(s);
+        if (len > LOG_TEXT - 1 - text)
+            len = LOG_TEXT - 1 - text;
+        memcpy(r->text + text, s, len);
+        r->text[text + len] = '\0';
+        r->args[i].u = text;
+        text += len + 1;
+        if (text >= LOG_TEXT)
+            text = LOG_TEXT - 1; //later strings come out empty
+    }
+}
+
+//one conversion, spec is '%' flags width precision and the conversion
+//with the length modifiers already taken out
+static int format_one(char *out, int cap, char *spec, int len, char conv, const struct log_record *r,
+                      const struct log_arg *a)
+{
+    switch (conv){
+        case 'd': case 'i':
+            memcpy(spec + len, "ll", 2);
+            spec[len + 2] = conv;
+            spec[len + 3] = '\0';
+            return snprintf(out, cap, spec, a->type == LOG_ARG_DOUBLE ? (long long) a->d : a->i);
+        case 'u': case 'o': case 'x': case 'X':
+            memcpy(spec + len, "ll", 2);
+            spec[len + 2] = conv;
+            spec[len + 3] = '\0';
+            return snprintf(out, cap, spec, a->type == LOG_ARG_DOUBLE ? (unsigned long long) a->d : a->u);
+        case 'c':
+            spec[len] = conv;
+            spec[len + 1] = '\0';
+            return snprintf(out, cap, spec, (int) a->i);
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            spec[len] = conv;
+            spec[len + 1] = '\0';
+            return snprintf(out, cap, spec, a->type == LOG_ARG_DOUBLE ? a->d :
+                                            a->type == LOG_ARG_UINT ? (double) a->u : (double) a->i);
+        case 's':
+            spec[len] = conv;
+            spec[len + 1] = '\0';
+            return snprintf(out, cap, spec, a->type == LOG_ARG_STR ? r->text + a->u : "?");
+        case 'p':
+            spec[len] = conv;
+            spec[len + 1] = '\0';
+            return snprintf(out, cap, spec, a->p);
+    }
+    return 0;
+}
+
+int log_format(const struct log_record *r, char *out, int cap)
+{
+    int n = 0, arg = 0;
+    const char *f = r->fmt;
+    while (*f && n < cap - 1){
+        if (*f != '%'){
+            out[n++] = *f++;
+            continue;
+        }
+        if (f[1] == '%'){
+            out[n++] = '%';
+            f += 2;
+            continue;
+        }
+        //flags, width, precision are kept, '*' takes an argument like printf
+        char spec[64];
+        int len = 0;
+        spec[len++] = *f++;
+        while (*f && strchr("-+ #0", *f) && len < 8)
+            spec[len++] = *f++;
+        for (int part = 0; part < 2; part++){
+            if (part == 1){
+                if (*f != '.')
+                    break;
+                spec[len++] = *f++;
+            }
+            if (*f == '*'){
+                f++;
+                int v = arg < r->nargs ? (int) r->args[arg++].i : 0;
+                len += snprintf(spec + len, 12, "%d", v);
+            }
+            while (isdigit((unsigned char) *f) && len < 24)
+                spec[len++] = *f++;
+        }
+        while (*f && strchr("hljztLq", *f))
+            f++;
+        char conv = *f;
+        if (!conv)
+            break;
+        f++;
+        if (conv == 'n')
+            continue;
+        if (arg >= r->nargs){
+            //more conversions than arguments, show where
+            n += snprintf(out + n, cap - n, "%%%c", conv);
+            continue;
+        }
+        int w = format_one(out + n, cap - n, spec, len, conv, r, &r->args[arg++]);
+        if (w > 0)
+            n += w;
+    }
+    if (n > cap - 1)
+        n = cap - 1;
+    out[n] = '\0';
+    return n;
+}
+
+static void write_record(const struct log_record *r)
+{
+    char line[LOG_LINE];
+    log_format(r, line, sizeof line);
+    fputs(line, lg.out ? lg.out : stderr);
+}
+
+//oldest record of any ring first, rings are each in order already
+static void drain(void)
+{
+    for (;;){
+        struct log_ring *best = NULL;
+        uint64_t best_time = 0;
+        for (struct log_ring *r = SDL_AtomicGetPtr((void **) &lg.rings); r; r = r->next){
+            int tail = SDL_AtomicGet(&r->tail);
+            if (tail == SDL_AtomicGet(&r->head))
+                continue;
+            uint64_t t = r->rec[tail & (LOG_RING - 1)].time;
+            if (!best || t < best_time){
+                best = r;
+                best_time = t;
+            }
+        }
+        if (!best)
+            break;
+        int tail = SDL_AtomicGet(&best->tail);
+        write_record(&best->rec[tail & (LOG_RING - 1)]);
+        //the slot goes back to its thread only after it was formatted
+        SDL_AtomicSet(&best->tail, tail + 1);
+    }
+    fflush(lg.out);
+}
+
+static int writer(void *arg)
+{
+    (void) arg;
+    while (!SDL_AtomicGet(&lg.quit)){
+        SDL_SemWait(lg.wake);
+        drain();
+    }
+    drain();
+    return 0;
+}
+
+int log_start(FILE *out, int min_level)
+{
+    lg.out = out;
+    lg.min_level = min_level;
+    SDL_AtomicSet(&lg.quit, 0);
+    lg.wake = SDL_CreateSemaphore(0);
+    if (!lg.wake)
+        return -1;
+    lg.thread = SDL_CreateThread(writer, "log", NULL);
+    if (!lg.thread){
+        SDL_DestroySemaphore(lg.wake);
+        return -1;
+    }
+    lg.active = 1;
+    return 0;
+}
+
+void log_stop(void)
+{
+    if (!lg.active)
+        return;
+    lg.active = 0;
+    SDL_AtomicSet(&lg.quit, 1);
+    SDL_SemPost(lg.wake);
+    SDL_WaitThread(lg.thread, NULL);
+    SDL_DestroySemaphore(lg.wake);
+    int dropped = 0;
+    for (struct log_ring *r = SDL_AtomicGetPtr((void **) &lg.rings); r; r = r->next)
+        dropped += SDL_AtomicGet(&r->dropped);
+    if (dropped){
+        fprintf(lg.out, "log: %d messages dropped\n", dropped);
+        fflush(lg.out);
+    }
+}
+
+void log_push(int level, const char *fmt, int nargs, const struct log_arg *args)
+{
+    if (level < lg.min_level)
+        return;
+    struct log_ring *r;
+    if (!lg.active || !(r = own_ring())){
+        struct log_record rec;
+        fill(&rec, level, fmt, nargs, args);
+        write_record(&rec);
+        return;
+    }
+    int head = SDL_AtomicGet(&r->head);
+    if (head - SDL_AtomicGet(&r->tail) == LOG_RING){
+        SDL_AtomicAdd(&r->dropped, 1);
+        return;
+    }
+    fill(&r->rec[head & (LOG_RING - 1)], level, fmt, nargs, args);
+    SDL_AtomicSet(&r->head, head + 1);
+    SDL_SemPost(lg.wake);
+}
@@ -0,0 +1,150 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * deferred logging that never blocks the caller.
+ *
+ *     LOG_INFO("scene: %d triangles from %s\n", count, path);
+ *
+ * the arguments are captured by type (_Generic) into a fixed size record
+ * in a ring owned by the calling thread, strings are copied, and the format
+ * string is kept by pointer, so it has to be a literal. a background thread
+ * merges the rings in time order, does the formatting and the stdio write.
+ * each ring has one writer and one reader, so pushing takes no locks; a
+ * full ring drops the record and counts it. before log_start() and after
+ * log_stop() records are formatted and written right away.
+ *
+ * levels below LOG_MIN_LEVEL (make LOG_LEVEL=n) compile to nothing,
+ * their arguments are not evaluated. the format is still checked.
+ * at most LOG_ARGS_MAX arguments.
+ */
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#define LOG_RING     256 //records per thread, power of 2
+#define LOG_ARGS_MAX 8
+#define LOG_TEXT     128 //copied string arguments, cut beyond that
+#define LOG_LINE     512 //formatted line
+
+enum log_arg_type{
+    LOG_ARG_INT,
+    LOG_ARG_UINT,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_STR,
+    LOG_ARG_PTR,
+};
+
+struct log_arg{
+    enum log_arg_type type;
+    union {
+        long long i;
+        unsigned long long u;
+        double d;
+        const char *s;  //in a record: u is the offset into text instead
+        const void *p;
+    };
+};
+
+struct log_record{
+    const char *fmt;
+    uint64_t time;
+    uint8_t level;
+    uint8_t nargs;
+    struct log_arg args[LOG_ARGS_MAX];
+    char text[LOG_TEXT];
+};
+
+//levels below min_level are dropped at run time too
+int  log_start(FILE *out, int min_level);
+//writes what is queued, joins the writer and reports drops
+void log_stop(void);
+void log_push(int level, const char *fmt, int nargs, const struct log_arg *args);
+//formats a record the way the writer does, for tests and the direct path
+int  log_format(const struct log_record *r, char *out, int cap);
+
+static inline __attribute__((format(printf, 1, 2))) void log_check_format(const char *fmt, ...)
+{
+    (void) fmt;
+}
+
+//only the selected function ever sees x, so every branch type checks
+static inline struct log_arg log_arg_i(long long x) { return (struct log_arg){.type = LOG_ARG_INT, .i = x}; }
+static inline struct log_arg log_arg_u(unsigned long long x) { return (struct log_arg){.type = LOG_ARG_UINT, .u = x}; }
+static inline struct log_arg log_arg_d(double x) { return (struct log_arg){.type = LOG_ARG_DOUBLE, .d = x}; }
+static inline struct log_arg log_arg_s(const char *x) { return (struct log_arg){.type = LOG_ARG_STR, .s = x}; }
+static inline struct log_arg log_arg_p(const void *x) { return (struct log_arg){.type = LOG_ARG_PTR, .p = x}; }
+
+#define LOG_ARG(x) _Generic((x), \
+    _Bool: log_arg_u, \
+    char: log_arg_i, \
+    signed char: log_arg_i, \
+    short: log_arg_i, \
+    int: log_arg_i, \
+    long: log_arg_i, \
+    long long: log_arg_i, \
+    unsigned char: log_arg_u, \
+    unsigned short: log_arg_u, \
+    unsigned int: log_arg_u, \
+    unsigned long: log_arg_u, \
+    unsigned long long: log_arg_u, \
+    float: log_arg_d, \
+    double: log_arg_d, \
+    char *: log_arg_s, \
+    const char *: log_arg_s, \
+    default: log_arg_p)(x)
+
+#define LOG_NARG_(_1, _2, _3, _4, _5, _6, _7, _8, _9, n, ...) n
+#define LOG_NARG(...) LOG_NARG_(__VA_ARGS__, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_CAT_(a, b) a##b
+#define LOG_CAT(a, b) LOG_CAT_(a, b)
+#define LOG_PACK_1(f) f, 0, NULL
+#define LOG_PACK_2(f, a) f, 1, (const struct log_arg[]){LOG_ARG(a)}
+#define LOG_PACK_3(f, a, b) f, 2, (const struct log_arg[]){LOG_ARG(a), LOG_ARG(b)}
+#define LOG_PACK_4(f, a, b, c) f, 3, (const struct log_arg[]){LOG_ARG(a), LOG_ARG(b), LOG_ARG(c)}
+#define LOG_PACK_5(f, a, b, c, d) f, 4, \
+    (const struct log_arg[]){LOG_ARG(a), LOG_ARG(b), LOG_ARG(c), LOG_ARG(d)}
+#define LOG_PACK_6(f, a, b, c, d, e) f, 5, \
+    (const struct log_arg[]){LOG_ARG(a), LOG_ARG(b), LOG_ARG(c), LOG_ARG(d), LOG_ARG(e)}
+#define LOG_PACK_7(f, a, b, c, d, e, g) f, 6, \
+    (const struct log_arg[]){LOG_ARG(a), LOG_ARG(b), LOG_ARG(c), LOG_ARG(d), LOG_ARG(e), LOG_ARG(g)}
+#define LOG_PACK_8(f, a, b, c, d, e, g, h) f, 7, \
+    (const struct log_arg[]){LOG_ARG(a), LOG_ARG(b), LOG_ARG(c), LOG_ARG(d), LOG_ARG(e), LOG_ARG(g), \
+                             LOG_ARG(h)}
+#define LOG_PACK_9(f, a, b, c, d, e, g, h, i) f, 8, \
+    (const struct log_arg[]){LOG_ARG(a), LOG_ARG(b), LOG_ARG(c), LOG_ARG(d), LOG_ARG(e), LOG_ARG(g), \
+                             LOG_ARG(h), LOG_ARG(i)}
+
+#define LOG_AT(level, ...) \
+    (0 ? log_check_format(__VA_ARGS__) \
+       : log_push(level, LOG_CAT(LOG_PACK_, LOG_NARG(__VA_ARGS__))(__VA_ARGS__)))
+//the check still sees the format, nothing is evaluated
+#define LOG_NONE(...) ((void) sizeof(log_check_format(__VA_ARGS__), 0))
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) LOG_NONE(__VA_ARGS__)
+#endif
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) LOG_NONE(__VA_ARGS__)
+#endif
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) LOG_NONE(__VA_ARGS__)
+#endif
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#endif
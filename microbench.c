@@ -0,0 +1,444 @@
+#include "common.h"
+#include <SDL.h>
+#include "gfx.h"
+#include "lin.h"
+#include "ui.h"
+#include "phys.h"
+#include "xform.h"
+
+/*
+ * headless micro-benchmarks, no window or GL context needed. glad/load
+ * opens a hidden window for its context and is skipped when it can't,
+ * glad/load_stub times the same loader against a fake driver.
+ * usage: ./microbench [-filter substring] [-ms per repetition]
+ *        ./microbench -check, what make check runs
+ * prints one tab separated line per benchmark: name, n, iterations per
+ * repetition, then the fastest and the median ns per iteration over REPS
+ * repetitions. names and n stay fixed so runs diff line by line,
+ * make bench writes bench.tsv.
+ */
+
+#define REPS 7
+#define LIN_N 1024
+#define PHYS_MAX 100000
+#define XFORM_MAX 10000
+#define SCREEN_W 1280
+#define SCREEN_H 720
+
+struct bench{
+    const char *name;
+    int n;
+    void (*setup)(int n);            //untimed, before every repetition, may be NULL
+    void (*run)(int n, int iters);
+};
+
+static uint64_t freq;
+static volatile float sink; //results go here so the work is not optimized out
+
+static mat4x4 ma[LIN_N], mb[LIN_N], mr[LIN_N];
+static vec4 va[LIN_N], vr[LIN_N];
+static vec3 v3[LIN_N];
+static quat qa[LIN_N];
+static struct phys_world world;
+static struct xform_set xs;
+static struct ui ui;
+static int points[256][2];
+
+static float frand(float lo, float hi)
+{
+    return lo + (hi - lo) * (rand() % 10000) / 10000.0f;
+}
+
+static void setup_lin(int n)
+{
+    (void) n;
+    for (int i = 0; i < LIN_N; i++){
+        mat4x4_identity(ma[i]);
+        mat4x4_rotate(ma[i], ma[i], frand(-1, 1), frand(-1, 1), frand(-1, 1) + 1.5f, frand(0, 3));
+        mat4x4_translate_in_place(ma[i], frand(-5, 5), frand(-5, 5), frand(-5, 5));
+        mat4x4_dup(mb[i], ma[(i * 7) % LIN_N]);
+        for (int k = 0; k < 4; k++)
+            va[i][k] = frand(-10, 10);
+        for (int k = 0; k < 3; k++)
+            v3[i][k] = frand(-10, 10);
+        vec4_norm(qa[i], va[i]);
+    }
+}
+
+static void run_mat4x4_mul(int n, int iters)
+{
+    for (int it = 0; it < iters; it++)
+        for (int i = 0; i < n; i++)
+            mat4x4_mul(mr[i], ma[i], mb[i]);
+    sink = mr[n - 1][3][3];
+}
+
+static void run_mat4x4_mul_vec4(int n, int iters)
+{
+    for (int it = 0; it < iters; it++)
+        for (int i = 0; i < n; i++)
+            mat4x4_mul_vec4(vr[i], ma[0], va[i]);
+    sink = vr[n - 1][3];
+}
+
+static void run_mat4x4_invert(int n, int iters)
+{
+    for (int it = 0; it < iters; it++)
+        for (int i = 0; i < n; i++)
+            mat4x4_invert(mr[i], ma[i]);
+    sink = mr[n - 1][3][3];
+}
+
+static void run_vec3_norm(int n, int iters)
+{
+    vec3 r;
+    float acc = 0.0f;
+    for (int it = 0; it < iters; it++)
+        for (int i = 0; i < n; i++){
+            vec3_norm(r, v3[i]);
+            acc += r[0];
+        }
+    sink = acc;
+}
+
+static void run_quat_mul_vec3(int n, int iters)
+{
+    vec3 r;
+    float acc = 0.0f;
+    for (int it = 0; it < iters; it++)
+        for (int i = 0; i < n; i++){
+            quat_mul_vec3(r, qa[i], v3[i]);
+            acc += r[0];
+        }
+    sink = acc;
+}
+
+static void *cb_nop(void *arg)
+{
+    return arg;
+}
+
+//chains of 8 nodes under each root, every node turned a little
+static void setup_xform(int n)
+{
+    xform_free(&xs);
+    if (xform_init(&xs, n) < 0)
+        die("xform_init: out of memory");
+    for (int i = 0; i < n; i++){
+        int id = xform_add(&xs, i % 8 ? i - 1 : -1);
+        quat q;
+        quat_rotate(q, frand(-1, 1), (vec3){0.0f, 0.0f, 1.0f});
+        xform_set_rotation(&xs, id, q);
+        xform_set_position(&xs, id, frand(-5, 5), frand(-5, 5), 0.0f);
+    }
+    xform_update(&xs);
+}
+
+//a sixteenth of the roots move each frame, their chains follow
+static void run_xform_update(int n, int iters)
+{
+    int moved = 0;
+    for (int it = 0; it < iters; it++){
+        for (int i = (it % 16) * 8; i < n; i += 16 * 8)
+            xform_set_position(&xs, i, frand(-5, 5), frand(-5, 5), 0.0f);
+        moved += xform_update(&xs);
+    }
+    sink = moved + xs.world[n - 1][3][0];
+}
+
+//n buttons in a grid, like the ones tri2 creates
+static void setup_ui(int n)
+{
+    char label[32];
+    ui_clear(&ui);
+    ui_set_screen_dim(&ui, SCREEN_W, SCREEN_H);
+    for (int i = 0; i < n; i++){
+        snprintf(label, sizeof label, "button %d", i);
+        int id = ui_create_button(&ui, 10 + (i % 10) * 125, 10 + (i / 10) * 70, 120, 64, label);
+        ui_register_callback(&ui, id, "Lclick", cb_nop);
+    }
+    //first use expands the glyphs and builds the sdf atlas, not timed
+    uint8_t rgb[4] = {255, 255, 255, 255};
+    ui_draw_text(&ui, 0, 0, "warm up", rgb);
+    ui_draw_text_scaled(&ui, 0, 0, 1.0f, "warm up", rgb);
+    ui_flush(&ui);
+    for (int i = 0; i < 256; i++){
+        points[i][0] = rand() % SCREEN_W;
+        points[i][1] = rand() % SCREEN_H;
+    }
+}
+
+static void run_ui_build(int n, int iters)
+{
+    (void) n;
+    for (int it = 0; it < iters; it++){
+        ui_flush(&ui);
+        if (ui_build(&ui) < 0)
+            die("ui_build: %s", ui_last_error(&ui));
+    }
+    sink = ui.n_vertices;
+}
+
+static void run_ui_draw_text(int n, int iters)
+{
+    static const char text[] = "The quick brown fox jumps over the lazy dog 0123456789 !?#%&*()[]";
+    uint8_t rgb[4] = {255, 255, 255, 255};
+    for (int it = 0; it < iters; it++){
+        ui_flush(&ui);
+        ui_draw_text(&ui, 10, 10, text + sizeof text - 1 - n, rgb);
+    }
+    sink = ui.n_pixels;
+}
+
+//the same text as quads at 4x, the cost is per glyph not per pixel
+static void run_ui_draw_text_sdf(int n, int iters)
+{
+    static const char text[] = "The quick brown fox jumps over the lazy dog 0123456789 !?#%&*()[]";
+    uint8_t rgb[4] = {255, 255, 255, 255};
+    for (int it = 0; it < iters; it++){
+        ui_flush(&ui);
+        if (ui_draw_text_scaled(&ui, 10, 10, 4.0f, text + sizeof text - 1 - n, rgb) < 0)
+            die("ui_draw_text_scaled: %s", ui_last_error(&ui));
+    }
+    sink = ui.n_quads;
+}
+
+//rows of a 400 pixel pane, what is below it is clipped away
+static void run_ui_scroll_list(int n, int iters)
+{
+    static const char *rows[] = {"alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel"};
+    uint8_t rgb[4] = {255, 255, 255, 255};
+    for (int it = 0; it < iters; it++){
+        ui_flush(&ui);
+        ui_push_clip(&ui, 10, 10, 300, 400);
+        for (int i = 0; i < n; i++)
+            ui_draw_label(&ui, 10, 10 + i * 15, rows[i & 7], rgb);
+        ui_pop_clip(&ui);
+    }
+    sink = ui.n_pixels;
+}
+
+static void run_ui_event(int n, int iters)
+{
+    (void) n;
+    int hits = 0;
+    for (int it = 0; it < iters; it++)
+        hits += ui_event(&ui, "Lclick", points[it & 255][0], points[it & 255][1]) >= 0;
+    sink = hits;
+}
+
+//a fresh scene of falling triangles, most of them awake
+static void setup_phys(int n)
+{
+    srand(0xBADBEEF0);
+    phys_clear(&world);
+    float size = 1.6f / sqrtf(n);
+    phys_set_cell_size(&world, size * 2.0f);
+    for (int i = 0; i < n; i++){
+        float x = frand(-1.0f, 1.0f - size), y = frand(world.floor_y, 1.0f);
+        uint8_t rgb[3] = {0};
+        phys_add_triangle(&world, (vec2){x, y}, (vec2){x + size, y}, (vec2){x + size / 2.0f, y + size}, rgb);
+    }
+}
+
+//what tri2's update() spends its time on, at the replay's fixed dt
+static void run_phys_step(int n, int iters)
+{
+    (void) n;
+    for (int it = 0; it < iters; it++)
+        phys_step(&world, 1.0f / 60);
+    sink = world.n_awake;
+}
+
+static struct gfx gfx;
+static int gl_ok = -1;
+
+//a hidden window made once, glad was loaded into it by gfx_init
+static void setup_gl(int n)
+{
+    (void) n;
+    if (gl_ok >= 0)
+        return;
+    gl_ok = SDL_Init(SDL_INIT_VIDEO) == 0 &&
+            gfx_init(&gfx, "microbench", 64, 64, GFX_WINDOW | GFX_GL | GFX_HIDDEN) == 0;
+}
+
+//what gfx_init does after the context exists, lookups included
+static void run_glad_load(int n, int iters)
+{
+    (void) n;
+    for (int it = 0; gl_ok && it < iters; it++)
+        if (!gladLoadGLLoader(SDL_GL_GetProcAddress))
+            die("gladLoadGLLoader failed");
+}
+
+//a driver reporting GL 3.2 with one extension, every other entry point a nop
+static const GLubyte *APIENTRY stub_get_string(GLenum name)
+{
+    return (const GLubyte *) (name == GL_VERSION ? "3.2 stub" : "stub");
+}
+static void APIENTRY stub_get_integerv(GLenum name, GLint *data)
+{
+    *data = name == GL_NUM_EXTENSIONS;
+}
+static const GLubyte *APIENTRY stub_get_stringi(GLenum name, GLuint i)
+{
+    (void) name;
+    (void) i;
+    return (const GLubyte *) "GL_ARB_stub";
+}
+typedef void (APIENTRYP nop_proc)(void);
+static void APIENTRY stub_nop(void)
+{
+}
+
+static int lookups;
+static void *stub_proc(const char *name)
+{
+    void *fn;
+    lookups++;
+    if (strcmp(name, "glGetString") == 0)
+        *(PFNGLGETSTRINGPROC *) &fn = stub_get_string;
+    else if (strcmp(name, "glGetIntegerv") == 0)
+        *(PFNGLGETINTEGERVPROC *) &fn = stub_get_integerv;
+    else if (strcmp(name, "glGetStringi") == 0)
+        *(PFNGLGETSTRINGIPROC *) &fn = stub_get_stringi;
+    else
+        *(nop_proc *) &fn = stub_nop;
+    return fn;
+}
+
+//glad's own share of a load, the driver lookups cost nothing here
+static void run_glad_load_stub(int n, int iters)
+{
+    (void) n;
+    lookups = 0;
+    for (int it = 0; it < iters; it++)
+        if (!gladLoadGLLoader(stub_proc))
+            die("gladLoadGLLoader failed on the stub");
+    sink = lookups;
+}
+
+static const struct bench benches[] = {
+    {"lin/mat4x4_mul",      LIN_N, setup_lin, run_mat4x4_mul},
+    {"lin/mat4x4_mul_vec4", LIN_N, setup_lin, run_mat4x4_mul_vec4},
+    {"lin/mat4x4_invert",   LIN_N, setup_lin, run_mat4x4_invert},
+    {"lin/vec3_norm",       LIN_N, setup_lin, run_vec3_norm},
+    {"lin/quat_mul_vec3",   LIN_N, setup_lin, run_quat_mul_vec3},
+    {"xform/update",        1000,  setup_xform, run_xform_update},
+    {"xform/update",        XFORM_MAX, setup_xform, run_xform_update},
+    {"ui/build",            1,     setup_ui,  run_ui_build},
+    {"ui/build",            10,    setup_ui,  run_ui_build},
+    {"ui/build",            100,   setup_ui,  run_ui_build},
+    {"ui/draw_text",        8,     setup_ui,  run_ui_draw_text},
+    {"ui/draw_text",        64,    setup_ui,  run_ui_draw_text},
+    {"ui/draw_text_sdf",    8,     setup_ui,  run_ui_draw_text_sdf},
+    {"ui/draw_text_sdf",    64,    setup_ui,  run_ui_draw_text_sdf},
+    {"ui/scroll_list",      100,   setup_ui,  run_ui_scroll_list},
+    {"ui/scroll_list",      4000,  setup_ui,  run_ui_scroll_list},
+    {"ui/event",            1,     setup_ui,  run_ui_event},
+    {"ui/event",            10,    setup_ui,  run_ui_event},
+    {"ui/event",            100,   setup_ui,  run_ui_event},
+    {"phys/step",           1000,  setup_phys, run_phys_step},
+    {"phys/step",           10000, setup_phys, run_phys_step},
+    {"phys/step",           PHYS_MAX, setup_phys, run_phys_step},
+    {"glad/load",           1,     setup_gl,  run_glad_load},
+    //last, it leaves the stub's pointers in glad
+    {"glad/load_stub",      1,     NULL,      run_glad_load_stub},
+};
+
+static double rsqrt_error(uint32_t bits)
+{
+    float x;
+    memcpy(&x, &bits, sizeof x);
+    double want = 1.0 / sqrt(x);
+    return fabs(lm_rsqrt_fast(x) - want) / want;
+}
+
+//the bounds lin.h documents for its _fast functions, against double
+//precision references so libm's own rounding doesn't count
+static int check_fast_math(void)
+{
+#if defined(__SSE__) || defined(_M_X64)
+    const double rsqrt_bound = 3e-7;
+#else
+    const double rsqrt_bound = 1.8e-3;
+#endif
+    const double sincos_bound = 1e-7, pi = 3.14159265358979323846;
+    double rel = 0.0, err = 0.0;
+    //every mantissa with both exponent parities, then a stride over all normals
+    for (uint32_t u = 0x3F800000; u < 0x40800000; u++)
+        rel = fmax(rel, rsqrt_error(u));
+    for (uint32_t u = 0x00800000; u < 0x7F800000; u += 61)
+        rel = fmax(rel, rsqrt_error(u));
+    for (int i = 0; i < 1 << 24; i++){
+        float a = -64 * pi + 128 * pi * i / (1 << 24), s, c;
+        lm_sincosf_fast(a, &s, &c);
+        err = fmax(err, fmax(fabs(s - sin(a)), fabs(c - cos(a))));
+    }
+    printf("name\tmax_error\tbound\n");
+    printf("lin/rsqrt_fast\t%.3g\t%.3g%s\n", rel, rsqrt_bound, rel < rsqrt_bound ? "" : "\tFAILED");
+    printf("lin/sincosf_fast\t%.3g\t%.3g%s\n", err, sincos_bound, err < sincos_bound ? "" : "\tFAILED");
+    return rel < rsqrt_bound && err < sincos_bound ? 0 : -1;
+}
+
+static double time_ns(const struct bench *b, int iters)
+{
+    if (b->setup)
+        b->setup(b->n);
+    uint64_t t0 = SDL_GetPerformanceCounter();
+    b->run(b->n, iters);
+    return (SDL_GetPerformanceCounter() - t0) * 1e9 / freq;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+    const char *filter = NULL;
+    double target_ms = 20.0;
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "-filter") == 0 && i + 1 < argc)
+            filter = argv[++i];
+        else if (strcmp(argv[i], "-ms") == 0 && i + 1 < argc)
+            target_ms = atof(argv[++i]);
+        else if (strcmp(argv[i], "-check") == 0)
+            return check_fast_math() < 0;
+        else
+            die("usage: %s [-filter substring] [-ms per repetition] | -check", argv[0]);
+    }
+    freq = SDL_GetPerformanceFrequency();
+    srand(0xBADBEEF0);
+    if (phys_init(&world, PHYS_MAX) < 0)
+        die("phys_init: out of memory");
+
+    printf("name\tn\titers\tmin_ns\tmedian_ns\n");
+    for (size_t i = 0; i < sizeof benches / sizeof benches[0]; i++){
+        const struct bench *b = &benches[i];
+        if (filter && !strstr(b->name, filter))
+            continue;
+        //one warm up iteration sizes the repetitions
+        double once = time_ns(b, 1);
+        int iters = once > 0 ? target_ms * 1e6 / once : 1;
+        if (iters < 1)
+            iters = 1;
+        if (b->run == run_glad_load && !gl_ok){
+            fprintf(stderr, "%s: no GL context, skipped\n", b->name);
+            continue;
+        }
+        double t[REPS];
+        for (int r = 0; r < REPS; r++)
+            t[r] = time_ns(b, iters) / iters;
+        qsort(t, REPS, sizeof t[0], cmp_double);
+        printf("%s\t%d\t%d\t%.1f\t%.1f\n", b->name, b->n, iters, t[0], t[REPS / 2]);
+        fflush(stdout);
+    }
+    phys_free(&world);
+    xform_free(&xs);
+    gfx_free(&gfx);
+    return 0;
+}
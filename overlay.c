@@ -0,0 +1,198 @@
+#include <SDL.h>
+#include "common.h"
+#include "overlay.h"
+
+#define GRAPH_H     60
+#define GRAPH_MS    (1000.0f / 30) //full height
+#define LINE_H      15
+#define MARGIN      10
+
+void overlay_init(struct overlay *o, const struct gputime *gpu)
+{
+    memset(o, 0, sizeof *o);
+    o->gpu = gpu;
+    o->freq = SDL_GetPerformanceFrequency();
+    o->dirty = 1;
+}
+
+void overlay_free(struct overlay *o)
+{
+    free(o->text);
+    o->text = NULL;
+    o->n_text = o->text_cap = 0;
+}
+
+int overlay_add_zone(struct overlay *o, const char *name)
+{
+    if (o->n_zones == OVERLAY_ZONES)
+        return -1;
+    o->zones[o->n_zones].name = name;
+    return o->n_zones++;
+}
+
+int overlay_add_pool(struct overlay *o, const char *name)
+{
+    if (o->n_pools == OVERLAY_POOLS)
+        return -1;
+    o->pools[o->n_pools].name = name;
+    return o->n_pools++;
+}
+
+void overlay_zone_begin(struct overlay *o, int zone)
+{
+    if (zone >= 0)
+        o->zones[zone].t0 = SDL_GetPerformanceCounter();
+}
+
+void overlay_zone_end(struct overlay *o, int zone)
+{
+    if (zone >= 0)
+        o->zones[zone].sum_ms += (SDL_GetPerformanceCounter() - o->zones[zone].t0) * 1000.0 / o->freq;
+}
+
+void overlay_pool(struct overlay *o, int pool, int used, int cap)
+{
+    if (pool < 0)
+        return;
+    o->pools[pool].used = used;
+    o->pools[pool].cap = cap;
+}
+
+void overlay_count(struct overlay *o, int draws, uint64_t upload_bytes)
+{
+    o->draws += draws;
+    o->upload_bytes += upload_bytes;
+}
+
+void overlay_frame(struct overlay *o, float frame_ms)
+{
+    uint64_t t0 = SDL_GetPerformanceCounter();
+    o->frame_ms[o->head] = frame_ms;
+    o->head = (o->head + 1) % OVERLAY_SAMPLES;
+    o->frames++;
+    o->sum_ms += frame_ms;
+    if (frame_ms > o->max_ms)
+        o->max_ms = frame_ms;
+
+    if (o->sum_ms >= OVERLAY_REFRESH_MS){
+        int n = o->frames;
+        o->shown.avg_ms = o->sum_ms / n;
+        o->shown.max_ms = o->max_ms;
+        o->shown.draws = (float) o->draws / n;
+        o->shown.upload_kb = o->upload_bytes / 1024.0f / n;
+        o->shown.self_ms = o->self_ms / n;
+        for (int i = 0; i < o->n_zones; i++){
+            o->zones[i].ms = o->zones[i].sum_ms / n;
+            o->zones[i].sum_ms = 0.0;
+        }
+        o->frames = 0;
+        o->sum_ms = o->self_ms = 0.0;
+        o->max_ms = 0.0f;
+        o->draws = o->upload_bytes = 0;
+        o->dirty = 1;
+    }
+    o->self_ms += (SDL_GetPerformanceCounter() - t0) * 1000.0 / o->freq;
+}
+
+//snprintf at buf + len, returns the new length, clamped to the buffer
+static int append(char *buf, int len, int cap, const char *fmt, ...)
+{
+    if (len >= cap)
+        return len;
+    va_list va;
+    va_start(va, fmt);
+    int n = vsnprintf(buf + len, cap - len, fmt, va);
+    va_end(va);
+    return n < 0 ? len : (len + n < cap ? len + n : cap - 1);
+}
+
+//draws the text into the ui and keeps a copy of the pixels it produced
+static int rebuild_text(struct overlay *o, struct ui *ui, int x, int y)
+{
+    char lines[6][128];
+    int n = 0, len;
+    uint8_t white[4] = {255, 255, 255, 255};
+
+    snprintf(lines[n++], sizeof lines[0], "frame %.2fms  max %.2fms  %.0f fps",
+             o->shown.avg_ms, o->shown.max_ms, o->shown.avg_ms > 0 ? 1000.0f / o->shown.avg_ms : 0.0f);
+    len = append(lines[n], 0, sizeof lines[0], "cpu");
+    for (int i = 0; i < o->n_zones; i++)
+        len = append(lines[n], len, sizeof lines[0], "  %s %.3f", o->zones[i].name, o->zones[i].ms);
+    n++;
+    if (o->gpu && o->gpu->ok){
+        len = append(lines[n], 0, sizeof lines[0], "gpu");
+        for (int i = 0; i < o->gpu->n_passes; i++)
+            len = append(lines[n], len, sizeof lines[0], "  %s %.3f", o->gpu->names[i], o->gpu->last_ms[i]);
+        n++;
+    }
+    snprintf(lines[n++], sizeof lines[0], "draws %.1f  upload %.1fKB per frame",
+             o->shown.draws, o->shown.upload_kb);
+    len = 0;
+    lines[n][0] = '\0';
+    for (int i = 0; i < o->n_pools; i++)
+        len = append(lines[n], len, sizeof lines[0], "%s%s %d/%d", i ? "  " : "",
+                     o->pools[i].name, o->pools[i].used, o->pools[i].cap);
+    n++;
+    snprintf(lines[n++], sizeof lines[0], "overlay %.3fms", o->shown.self_ms);
+
+    int first = ui->n_pixels;
+    for (int i = 0; i < n; i++)
+        ui_draw_text(ui, x, y + i * LINE_H, lines[i], white);
+    int count = ui->n_pixels - first;
+    if (count > o->text_cap){
+        uvec2 *p = realloc(o->text, sizeof *p * count);
+        if (!p){
+            o->last_error = "out of memory";
+            return -1;
+        }
+        o->text = p;
+        o->text_cap = count;
+    }
+    memcpy(o->text, ui->data.pixels + first, sizeof *o->text * count);
+    o->n_text = count;
+    o->text_x = x;
+    o->text_y = y;
+    o->dirty = 0;
+    return 0;
+}
+
+int overlay_draw(struct overlay *o, struct ui *ui)
+{
+    if (!o->visible)
+        return 0;
+    uint64_t t0 = SDL_GetPerformanceCounter();
+    int x = ui->screen_width - OVERLAY_WIDTH - MARGIN;
+    int y = MARGIN;
+    if (x < 0)
+        x = 0;
+    int lines = 5 + (o->gpu && o->gpu->ok);
+    int text_y = y + GRAPH_H + 4;
+
+    urect back = {x - 4, y - 4, OVERLAY_WIDTH + 8, GRAPH_H + 8 + lines * LINE_H + 4, {0, 0, 0, 0xB0}};
+    ui_put_rect(ui, &back);
+    //16.6ms mark, then the bars oldest first
+    int mark = GRAPH_H * (1000.0f / 60) / GRAPH_MS;
+    urect line = {x, y + GRAPH_H - mark, OVERLAY_WIDTH, 1, {255, 255, 255, 0x60}};
+    ui_put_rect(ui, &line);
+    for (int i = 0; i < OVERLAY_SAMPLES; i++){
+        float ms = o->frame_ms[(o->head + i) % OVERLAY_SAMPLES];
+        int h = ms >= GRAPH_MS ? GRAPH_H : (int) (GRAPH_H * ms / GRAPH_MS);
+        if (h <= 0)
+            continue;
+        urect bar = {x + i * 4, y + GRAPH_H - h, 3, h, {80, 220, 80, 255}};
+        if (ms > 1000.0f / 30)
+            memcpy(bar.rgb, (uint8_t[4]){230, 60, 60, 255}, 4);
+        else if (ms > 1000.0f / 58)
+            memcpy(bar.rgb, (uint8_t[4]){230, 200, 60, 255}, 4);
+        if (ui_put_rect(ui, &bar) < 0)
+            break;
+    }
+
+    int ret = 0;
+    if (o->dirty || x != o->text_x || text_y != o->text_y)
+        ret = rebuild_text(o, ui, x, text_y);
+    else
+        ui_put_pixels(ui, o->text, o->n_text);
+    o->self_ms += (SDL_GetPerformanceCounter() - t0) * 1000.0 / o->freq;
+    return ret;
+}
@@ -0,0 +1,83 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <stdint.h>
+#include "glad/glad.h"
+#include "ui.h"
+#include "gputime.h"
+
+/*
+ * live performance overlay, drawn as ui rects and pixels in the top right
+ * corner: a frame time graph, cpu zone times, gpu pass times, draw call and
+ * upload counters and pool usage. it has to stay cheap itself, so the text
+ * is only rasterized again every OVERLAY_REFRESH_MS and copied from a cache
+ * in between, per frame work is the graph bars and one memcpy. the time
+ * the overlay takes is shown on its last line.
+ */
+
+#define OVERLAY_SAMPLES    128 //graph bars, one per frame
+#define OVERLAY_ZONES      8
+#define OVERLAY_POOLS      8
+#define OVERLAY_REFRESH_MS 250
+#define OVERLAY_WIDTH      (OVERLAY_SAMPLES * 4) //about 50 characters
+
+struct overlay_zone{
+    const char *name;
+    uint64_t t0;
+    double sum_ms;   //this window
+    float ms;        //shown, per frame average of the last window
+};
+
+struct overlay_pool{
+    const char *name;
+    int used;
+    int cap;
+};
+
+struct overlay{
+    int visible;
+    const struct gputime *gpu; //optional
+    uint64_t freq;
+
+    float frame_ms[OVERLAY_SAMPLES];
+    int head;                  //oldest sample
+
+    //accumulated over one refresh window, then copied to the shown values
+    int frames;
+    double sum_ms;
+    float max_ms;
+    uint64_t draws, upload_bytes;
+    double self_ms;
+    struct {
+        float avg_ms, max_ms;
+        float draws, upload_kb; //per frame
+        float self_ms;
+    } shown;
+
+    struct overlay_zone zones[OVERLAY_ZONES];
+    int n_zones;
+    struct overlay_pool pools[OVERLAY_POOLS];
+    int n_pools;
+
+    uvec2 *text;               //rasterized text, copied into the ui every frame
+    int n_text, text_cap;
+    int text_x, text_y;
+    int dirty;
+    const char *last_error;
+};
+
+void overlay_init(struct overlay *o, const struct gputime *gpu);
+void overlay_free(struct overlay *o);
+//names must outlive the overlay, -1 when full
+int  overlay_add_zone(struct overlay *o, const char *name);
+int  overlay_add_pool(struct overlay *o, const char *name);
+void overlay_zone_begin(struct overlay *o, int zone);
+void overlay_zone_end(struct overlay *o, int zone);
+void overlay_pool(struct overlay *o, int pool, int used, int cap);
+void overlay_count(struct overlay *o, int draws, uint64_t upload_bytes);
+//once per frame, collects even while hidden so the graph is full when shown
+void overlay_frame(struct overlay *o, float frame_ms);
+//between ui_flush() and ui_build()/ui_display()
+int  overlay_draw(struct overlay *o, struct ui *ui);
+
+#endif
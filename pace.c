@@ -0,0 +1,91 @@
+#include <math.h>
+#include <SDL.h>
+#include "common.h"
+#include "pace.h"
+
+void pace_init(struct pacer *p, enum pace_mode mode, double rate)
+{
+    memset(p, 0, sizeof *p);
+    p->mode = mode;
+    p->rate = rate;
+    p->freq = SDL_GetPerformanceFrequency();
+    p->period = mode == PACE_UNCAPPED || rate <= 0 ? 0 : p->freq / rate;
+    p->margin = p->freq / 1000;
+    p->last = SDL_GetPerformanceCounter();
+    p->deadline = p->last + p->period;
+}
+
+static void wait_until(struct pacer *p, uint64_t deadline)
+{
+    uint64_t min_margin = p->freq / 5000, max_margin = p->freq / 250; //0.2ms .. 4ms
+    for (;;){
+        uint64_t now = SDL_GetPerformanceCounter();
+        if (now >= deadline)
+            return;
+        uint64_t left = deadline - now;
+        uint32_t ms = left > p->margin ? (left - p->margin) * 1000 / p->freq : 0;
+        if (ms == 0)
+            break;
+        SDL_Delay(ms);
+        //how much later than asked the sleep returned, the margin has to cover it
+        uint64_t slept = SDL_GetPerformanceCounter() - now, asked = ms * p->freq / 1000;
+        uint64_t over = slept > asked ? slept - asked : 0;
+        p->margin -= p->margin / 64;
+        if (over > p->margin)
+            p->margin = over;
+        if (p->margin < min_margin)
+            p->margin = min_margin;
+        if (p->margin > max_margin)
+            p->margin = max_margin;
+    }
+    while (SDL_GetPerformanceCounter() < deadline)
+        ;
+}
+
+uint64_t pace_wait(struct pacer *p)
+{
+    uint64_t start = SDL_GetPerformanceCounter();
+    if (p->mode == PACE_FIXED && p->period)
+        wait_until(p, p->deadline);
+    uint64_t now = SDL_GetPerformanceCounter();
+
+    double interval = (now - p->last) * 1e6 / p->freq;
+    p->stats.frames++;
+    p->stats.sum_us += interval;
+    p->stats.sum_sq_us += interval * interval;
+    if (p->period){
+        double err = fabs(interval - p->period * 1e6 / p->freq);
+        if (err > p->stats.worst_us)
+            p->stats.worst_us = err;
+    }
+    p->last = now;
+
+    if (p->period){
+        if (now > p->deadline + p->period / 2){
+            p->stats.missed++;
+            p->deadline = now;
+        }
+        //vsync deadlines are only for counting misses, the swap keeps time
+        else if (p->mode == PACE_VSYNC)
+            p->deadline = now;
+        p->deadline += p->period;
+    }
+    return now - start;
+}
+
+void pace_interval_ms(const struct pacer *p, double *mean, double *stddev)
+{
+    uint64_t n = p->stats.frames;
+    *mean = *stddev = 0.0;
+    if (!n)
+        return;
+    double m = p->stats.sum_us / n;
+    double var = p->stats.sum_sq_us / n - m * m;
+    *mean = m / 1000.0;
+    *stddev = var > 0.0 ? sqrt(var) / 1000.0 : 0.0;
+}
+
+void pace_reset_stats(struct pacer *p)
+{
+    memset(&p->stats, 0, sizeof p->stats);
+}
@@ -0,0 +1,48 @@
+#ifndef PACE_H
+#define PACE_H
+
+#include <stdint.h>
+
+/*
+ * frame pacing against absolute deadlines. every frame is due one period
+ * after the previous deadline, not after the previous frame ended, so
+ * timing errors don't add up. the pacer sleeps in whole milliseconds until
+ * it is within a safety margin of the deadline and spins for the rest.
+ * the margin follows how late SDL_Delay wakes up on this machine.
+ * a frame more than half a period late is counted as missed and the
+ * deadlines restart from it instead of rushing to catch up.
+ */
+
+enum pace_mode{
+    PACE_FIXED,    //our own deadlines at rate hz
+    PACE_VSYNC,    //the swap blocks, only measured against rate hz
+    PACE_UNCAPPED, //no waiting, only measured
+};
+
+struct pace_stats{
+    uint64_t frames;
+    uint64_t missed;
+    double sum_us;     //frame intervals
+    double sum_sq_us;
+    double worst_us;   //largest distance of an interval from the period
+};
+
+struct pacer{
+    enum pace_mode mode;
+    double rate;
+    uint64_t freq;
+    uint64_t period;   //ticks, 0 when uncapped
+    uint64_t deadline;
+    uint64_t last;     //previous frame start
+    uint64_t margin;   //left for spinning after the last sleep
+    struct pace_stats stats;
+};
+
+void pace_init(struct pacer *p, enum pace_mode mode, double rate);
+//returns when the next frame should start, with the ticks spent waiting
+uint64_t pace_wait(struct pacer *p);
+//mean interval and its standard deviation, in milliseconds
+void pace_interval_ms(const struct pacer *p, double *mean, double *stddev);
+void pace_reset_stats(struct pacer *p);
+
+#endif
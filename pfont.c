@@ -0,0 +1,196 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <SDL.h>
+#include "common.h"
+#include "glad/glad.h" //font.h needs the GL types
+#include "font.h"
+#include "pfont.h"
+
+_Static_assert(sizeof(struct pfont_header) == 32, "pfont_header is part of the file format");
+_Static_assert(sizeof(struct pfont_range) == 12, "pfont_range is part of the file format");
+_Static_assert(sizeof(struct pfont_glyph) == 12, "pfont_glyph is part of the file format");
+
+int pfont_lookup(const struct pfont *f, uint32_t cp)
+{
+    int lo = 0, hi = f->hdr->n_ranges;
+    while (lo < hi){
+        int mid = (lo + hi) / 2;
+        const struct pfont_range *r = &f->ranges[mid];
+        if (cp < r->first)
+            hi = mid;
+        else if (cp - r->first >= r->count)
+            lo = mid + 1;
+        else
+            return r->glyph + (cp - r->first);
+    }
+    return f->hdr->missing;
+}
+
+uint32_t pfont_utf8_next(const char **s)
+{
+    const uint8_t *p = (const uint8_t *) *s;
+    uint32_t cp = p[0];
+    int n = cp < 0x80 ? 0 : cp >= 0xC2 && cp < 0xE0 ? 1 : cp >= 0xE0 && cp < 0xF0 ? 2 :
+            cp >= 0xF0 && cp < 0xF5 ? 3 : -1;
+    *s += 1;
+    if (n <= 0)
+        return n < 0 ? 0xFFFD : cp;
+    cp &= 0x3F >> n;
+    for (int i = 1; i <= n; i++){
+        if ((p[i] & 0xC0) != 0x80)
+            return 0xFFFD; //p[i] starts the next codepoint
+        cp = cp << 6 | (p[i] & 0x3F);
+    }
+    //overlong, surrogate or past U+10FFFF
+    if ((n == 2 && cp < 0x800) || (n == 3 && (cp < 0x10000 || cp > 0x10FFFF)) ||
+        (cp >= 0xD800 && cp < 0xE000))
+        return 0xFFFD;
+    *s += n;
+    return cp;
+}
+
+int pfont_init(struct pfont *f, const void *data, size_t size)
+{
+    memset(f, 0, sizeof *f);
+    f->size = size;
+    const struct pfont_header *hdr = data;
+    if (size < sizeof *hdr || (uintptr_t) data % 4 || memcmp(hdr->magic, "PFNT", 4) != 0 ||
+        hdr->version != PFONT_VERSION || hdr->header_size != sizeof *hdr)
+    {
+        f->last_error = "pfont: not a font file or wrong version";
+        return -1;
+    }
+    uint64_t glyphs = sizeof *hdr + sizeof(struct pfont_range) * (uint64_t) hdr->n_ranges;
+    uint64_t bits = glyphs + sizeof(struct pfont_glyph) * (uint64_t) hdr->n_glyphs;
+    if (!hdr->n_glyphs || hdr->n_glyphs > PFONT_MAX_GLYPHS || hdr->missing >= hdr->n_glyphs ||
+        bits > size || hdr->bitmap_bytes > size - bits)
+    {
+        f->last_error = "pfont: bad section sizes";
+        return -1;
+    }
+    f->ranges = (const void *) ((const char *) data + sizeof *hdr);
+    f->glyphs = (const void *) ((const char *) data + glyphs);
+    f->bits = (const uint8_t *) data + bits;
+
+    for (uint32_t i = 0; i < hdr->n_ranges; i++){
+        const struct pfont_range *r = &f->ranges[i];
+        if (!r->count || r->first + (uint64_t) r->count > 0x110000 ||
+            r->glyph + (uint64_t) r->count > hdr->n_glyphs ||
+            (i && (r->first < f->ranges[i - 1].first ||
+                   r->first - f->ranges[i - 1].first < f->ranges[i - 1].count)))
+        {
+            f->last_error = "pfont: bad range table";
+            return -1;
+        }
+    }
+    for (uint32_t i = 0; i < hdr->n_glyphs; i++){
+        const struct pfont_glyph *g = &f->glyphs[i];
+        if (g->bits + (uint64_t) (g->w + 7) / 8 * g->h > hdr->bitmap_bytes){
+            f->last_error = "pfont: glyph bitmap out of bounds";
+            return -1;
+        }
+        if (g->x + g->w > f->extent)
+            f->extent = g->x + g->w;
+        if (g->y + g->h > f->extent)
+            f->extent = g->y + g->h;
+    }
+    f->hdr = hdr;
+    for (int cp = 0; cp < 128; cp++)
+        f->ascii[cp] = pfont_lookup(f, cp);
+    return 0;
+}
+
+int pfont_open(struct pfont *f, const char *path)
+{
+    memset(f, 0, sizeof *f);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0){
+        f->last_error = "pfont: cannot open file";
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(struct pfont_header)){
+        close(fd);
+        f->last_error = "pfont: file too small";
+        return -1;
+    }
+    size_t size = st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED){
+        f->last_error = "pfont: mmap failed";
+        return -1;
+    }
+    if (pfont_init(f, map, size) < 0){
+        munmap(map, size);
+        return -1;
+    }
+    madvise(map, size, MADV_WILLNEED);
+    f->map = map;
+    return 0;
+}
+
+void pfont_close(struct pfont *f)
+{
+    if (f->map)
+        munmap(f->map, f->size);
+    memset(f, 0, sizeof *f);
+}
+
+int pfont_save(const struct pfont *f, const char *path)
+{
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+        return -1;
+    int s = fwrite(f->hdr, 1, f->size, fp) == f->size ? 0 : -1;
+    if (fclose(fp) != 0)
+        s = -1;
+    return s;
+}
+
+#define BUILTIN_GLYPHS 95
+#define BUILTIN_BITS   (sizeof(struct pfont_header) + sizeof(struct pfont_range) + \
+                        sizeof(struct pfont_glyph) * BUILTIN_GLYPHS)
+
+//RASTERS are glBitmap rows, bottom up. they were always drawn a pixel below
+//the line top, y = 1 keeps every pixel where it was
+static int build_builtin(struct pfont *f, uint32_t *image)
+{
+    char *p = (char *) image;
+    struct pfont_header hdr = {
+        .magic = "PFNT", .version = PFONT_VERSION, .header_size = sizeof hdr,
+        .n_ranges = 1, .n_glyphs = BUILTIN_GLYPHS, .bitmap_bytes = BUILTIN_GLYPHS * 13,
+        .height = 13, .missing = 0, //the blank space
+    };
+    struct pfont_range r = {32, BUILTIN_GLYPHS, 0};
+    memcpy(p, &hdr, sizeof hdr);
+    memcpy(p + sizeof hdr, &r, sizeof r);
+    struct pfont_glyph *glyphs = (void *) (p + sizeof hdr + sizeof r);
+    uint8_t *bits = (uint8_t *) p + BUILTIN_BITS;
+    for (int g = 0; g < BUILTIN_GLYPHS; g++){
+        glyphs[g] = (struct pfont_glyph){
+            .bits = g * 13, .w = 8, .h = 13, .x = 0, .y = 1, .advance = 8 + RASTERS_SPACING,
+        };
+        for (int row = 0; row < 13; row++)
+            bits[g * 13 + row] = RASTERS[g][12 - row];
+    }
+    return pfont_init(f, image, BUILTIN_BITS + BUILTIN_GLYPHS * 13);
+}
+
+//built once, whichever thread comes first; the others wait on the lock
+const struct pfont *pfont_builtin(void)
+{
+    static uint32_t image[(BUILTIN_BITS + BUILTIN_GLYPHS * 13 + 3) / 4];
+    static struct pfont f;
+    static SDL_SpinLock lock;
+    static SDL_atomic_t state; //0 not built yet, 1 built, -1 failed
+    if (!SDL_AtomicGet(&state)){
+        SDL_AtomicLock(&lock);
+        if (!SDL_AtomicGet(&state))
+            SDL_AtomicSet(&state, build_builtin(&f, image) < 0 ? -1 : 1);
+        SDL_AtomicUnlock(&lock);
+    }
+    return SDL_AtomicGet(&state) > 0 ? &f : NULL;
+}
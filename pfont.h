@@ -0,0 +1,80 @@
+#ifndef PFONT_H
+#define PFONT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * packed bitmap fonts. a file is used in place: mapping and validating it
+ * is all opening does, so switching or adding fonts costs no parsing.
+ * host byte order (little endian), the version is bumped on any change.
+ *
+ * file: header, ranges, glyphs, then the bitmaps
+ *   ranges:  codepoints first .. first + count - 1 are glyphs glyph .. ,
+ *            sorted and not overlapping
+ *   bitmaps: 1 bit per pixel, rows top down, each row w bits from the
+ *            most significant bit, padded to a byte
+ */
+
+#define PFONT_VERSION 1
+#define PFONT_MAX_GLYPHS 65535
+
+struct pfont_header{
+    char magic[4];      //"PFNT"
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t n_ranges;
+    uint32_t n_glyphs;
+    uint32_t bitmap_bytes;
+    uint16_t height;    //line height, text is centred on it
+    uint16_t missing;   //glyph drawn for codepoints no range covers
+    uint32_t reserved;
+};
+
+struct pfont_range{
+    uint32_t first;
+    uint32_t count;
+    uint32_t glyph;
+};
+
+struct pfont_glyph{
+    uint32_t bits;      //offset of the bitmap in the bitmap section
+    uint8_t w, h;
+    uint8_t x, y;       //bitmap offset from the pen position, y down from the line top
+    uint8_t advance;    //pen movement, proportional fonts differ per glyph
+    uint8_t pad[3];
+};
+
+struct pfont{
+    void *map;          //NULL for fonts that live in memory
+    size_t size;
+    const struct pfont_header *hdr;
+    const struct pfont_range *ranges;
+    const struct pfont_glyph *glyphs;
+    const uint8_t *bits;
+    uint16_t ascii[128]; //glyph of every codepoint below 128
+    uint16_t extent;     //how far right of or below the pen any bitmap reaches
+    const char *last_error;
+};
+
+//maps and validates the file
+int  pfont_open(struct pfont *f, const char *path);
+//the same over an image already in memory, which must outlive f
+int  pfont_init(struct pfont *f, const void *data, size_t size);
+void pfont_close(struct pfont *f);
+//writes f's image, what pfont_open() reads back
+int  pfont_save(const struct pfont *f, const char *path);
+//the compiled in 8x13 font, printable ascii only. thread safe, NULL if it
+//failed to build
+const struct pfont *pfont_builtin(void);
+
+//ranges past ascii, a binary search
+int pfont_lookup(const struct pfont *f, uint32_t cp);
+static inline int pfont_glyph(const struct pfont *f, uint32_t cp)
+{
+    return cp < 128 ? f->ascii[cp] : pfont_lookup(f, cp);
+}
+//decodes one codepoint and moves *s past it, U+FFFD for malformed bytes
+uint32_t pfont_utf8_next(const char **s);
+
+#endif
@@ -0,0 +1,1015 @@
+#include "common.h"
+#include "phys.h"
+#include "prof.h"
+
+#define PHYS_GRAVITY 1.0
+#define PHYS_CELL 0.1
+#define MAX_CELLS_PER_BODY 64
+#define SOLVER_ITERATIONS 6
+#define FRICTION 0.5f
+#define CORRECTION 0.4f   //share of the penetration removed per step
+#define SLOP 0.0005f
+#define SLEEP_LINEAR 0.02f  //units per second
+#define SLEEP_ANGULAR 0.1f  //radians per second
+#define SLEEP_STEPS 30
+#define WAKE_SPEED 0.3f     //impact speed that wakes a sleeping body
+
+static inline float cross2(vec2 a, vec2 b)
+{
+    return a[0] * b[1] - a[1] * b[0];
+}
+
+static int grow(void **arr, int *cap, int need, size_t elem)
+{
+    if (need <= *cap)
+        return 0;
+    int ncap = *cap ? *cap : 1024;
+    while (ncap < need)
+        ncap *= 2;
+    void *p = realloc(*arr, elem * ncap);
+    if (!p)
+        return -1;
+    *arr = p;
+    *cap = ncap;
+    return 0;
+}
+
+int phys_init(struct phys_world *w, int cap)
+{
+    memset(w, 0, sizeof *w);
+    int n_static_buckets = 1;
+    while (n_static_buckets < cap * 2)
+        n_static_buckets *= 2;
+    w->vertices    = malloc(sizeof(struct vertex) * 3 * cap);
+    w->boxes       = malloc(sizeof(struct aabb) * cap);
+    w->state       = malloc(cap);
+    w->pos         = malloc(sizeof(vec2) * cap);
+    w->vel         = malloc(sizeof(vec2) * cap);
+    w->angle       = malloc(sizeof(float) * cap);
+    w->angvel      = malloc(sizeof(float) * cap);
+    w->local       = malloc(sizeof(vec2) * 3 * cap);
+    w->inv_mass    = malloc(sizeof(float) * cap);
+    w->inv_inertia = malloc(sizeof(float) * cap);
+    w->still       = malloc(sizeof(uint16_t) * cap);
+    w->awake       = malloc(sizeof(int) * cap);
+    w->awake_slot  = malloc(sizeof(int) * cap);
+    w->island      = malloc(sizeof(int) * cap);
+    w->awake_big   = malloc(sizeof(int) * cap);
+    w->static_big  = malloc(sizeof(int) * cap);
+    w->body_static = malloc(sizeof(int) * cap);
+    w->static_head = malloc(sizeof(int) * n_static_buckets);
+    if (!w->vertices || !w->boxes || !w->state || !w->pos || !w->vel || !w->angle ||
+        !w->angvel || !w->local || !w->inv_mass || !w->inv_inertia || !w->still ||
+        !w->awake || !w->awake_slot || !w->island || !w->awake_big || !w->static_big ||
+        !w->body_static || !w->static_head){
+        phys_free(w);
+        return -1;
+    }
+    w->cap = cap;
+    w->n_static_buckets = n_static_buckets;
+    w->floor_y = -1.0f;
+    w->gravity = PHYS_GRAVITY;
+    w->cell_size = PHYS_CELL;
+    phys_clear(w);
+    return 0;
+}
+
+void phys_free(struct phys_world *w)
+{
+    free(w->vertices);
+    free(w->boxes);
+    free(w->state);
+    free(w->pos);
+    free(w->vel);
+    free(w->angle);
+    free(w->angvel);
+    free(w->local);
+    free(w->inv_mass);
+    free(w->inv_inertia);
+    free(w->still);
+    free(w->awake);
+    free(w->awake_slot);
+    free(w->island);
+    free(w->awake_big);
+    free(w->static_big);
+    free(w->body_static);
+    free(w->static_head);
+    free(w->static_entries);
+    free(w->bucket_start);
+    free(w->entries);
+    free(w->sorted);
+    free(w->pairs);
+    free(w->contacts);
+    free(w->warm);
+    memset(w, 0, sizeof *w);
+}
+
+void phys_clear(struct phys_world *w)
+{
+    w->count = 0;
+    w->n_awake = 0;
+    w->n_pairs = 0;
+    w->n_contacts = 0;
+    w->n_static_big = 0;
+    if (w->warm)
+        memset(w->warm, 0, sizeof(struct phys_warm) * w->warm_cap);
+    w->warm_used = 0;
+    w->static_free = -1;
+    w->dirty_lo = w->dirty_hi = 0;
+    //drop every static entry
+    for (int i = 0; i < w->static_cap; i++){
+        w->static_entries[i].next = w->static_free;
+        w->static_free = i;
+    }
+    memset(w->static_head, 0xFF, sizeof(int) * w->n_static_buckets);
+}
+
+static void mark_dirty(struct phys_world *w, int i)
+{
+    if (w->dirty_lo >= w->dirty_hi){
+        w->dirty_lo = i;
+        w->dirty_hi = i + 1;
+        return;
+    }
+    if (i < w->dirty_lo)
+        w->dirty_lo = i;
+    if (i + 1 > w->dirty_hi)
+        w->dirty_hi = i + 1;
+}
+
+void phys_clear_dirty(struct phys_world *w)
+{
+    w->dirty_lo = w->dirty_hi = 0;
+}
+
+static inline int cell_of(float v, float inv_cell)
+{
+    return (int) floorf(v * inv_cell);
+}
+
+static inline unsigned bucket_of(int ix, int iy, int n_buckets)
+{
+    return ((unsigned) ix * 73856093U ^ (unsigned) iy * 19349663U) & (n_buckets - 1);
+}
+
+static inline int boxes_overlap(const struct aabb *a, const struct aabb *b)
+{
+    return a->minx <= b->maxx && b->minx <= a->maxx &&
+           a->miny <= b->maxy && b->miny <= a->maxy;
+}
+
+//cell range of a box. 1 for oversized bodies, which stay out of the grids
+//and get tested against every other body instead
+static int box_cells(struct aabb *b, float inv_cell, int *x0, int *x1, int *y0, int *y1)
+{
+    *x0 = cell_of(b->minx, inv_cell);
+    *x1 = cell_of(b->maxx, inv_cell);
+    *y0 = cell_of(b->miny, inv_cell);
+    *y1 = cell_of(b->maxy, inv_cell);
+    return ((int64_t) *x1 - *x0 + 1) * ((int64_t) *y1 - *y0 + 1) > MAX_CELLS_PER_BODY;
+}
+
+//the cell owning a pair, so pairs spanning several cells are reported once
+static inline int owns_pair(struct aabb *a, struct aabb *b, int ix, int iy, float inv_cell)
+{
+    float ox = a->minx > b->minx ? a->minx : b->minx;
+    float oy = a->miny > b->miny ? a->miny : b->miny;
+    return cell_of(ox, inv_cell) == ix && cell_of(oy, inv_cell) == iy;
+}
+
+static int static_insert(struct phys_world *w, int body)
+{
+    int x0, x1, y0, y1;
+    float inv_cell = 1.0f / w->cell_size;
+    w->body_static[body] = -1;
+    if (box_cells(&w->boxes[body], inv_cell, &x0, &x1, &y0, &y1)){
+        w->static_big[w->n_static_big++] = body;
+        return 0;
+    }
+    for (int y = y0; y <= y1; y++){
+        for (int x = x0; x <= x1; x++){
+            if (w->static_free < 0){
+                int old = w->static_cap;
+                if (grow((void **) &w->static_entries, &w->static_cap, old + 1, sizeof(struct phys_static_entry)) < 0)
+                    return -1;
+                for (int i = w->static_cap - 1; i >= old; i--){
+                    w->static_entries[i].next = w->static_free;
+                    w->static_free = i;
+                }
+            }
+            int e = w->static_free;
+            struct phys_static_entry *se = &w->static_entries[e];
+            w->static_free = se->next;
+            unsigned bk = bucket_of(x, y, w->n_static_buckets);
+            se->ix = x;
+            se->iy = y;
+            se->body = body;
+            se->prev = -1;
+            se->next = w->static_head[bk];
+            if (se->next >= 0)
+                w->static_entries[se->next].prev = e;
+            w->static_head[bk] = e;
+            se->body_next = w->body_static[body];
+            w->body_static[body] = e;
+        }
+    }
+    return 0;
+}
+
+//oversized sleepers are few, finding one is a linear search
+static int static_big_slot(struct phys_world *w, int body)
+{
+    for (int k = 0; k < w->n_static_big; k++)
+        if (w->static_big[k] == body)
+            return k;
+    return -1;
+}
+
+static void static_remove(struct phys_world *w, int body)
+{
+    int e = w->body_static[body];
+    if (e < 0){
+        int k = static_big_slot(w, body);
+        if (k >= 0)
+            w->static_big[k] = w->static_big[--w->n_static_big];
+        return;
+    }
+    while (e >= 0){
+        struct phys_static_entry *se = &w->static_entries[e];
+        int body_next = se->body_next;
+        if (se->prev >= 0)
+            w->static_entries[se->prev].next = se->next;
+        else
+            w->static_head[bucket_of(se->ix, se->iy, w->n_static_buckets)] = se->next;
+        if (se->next >= 0)
+            w->static_entries[se->next].prev = se->prev;
+        se->next = w->static_free;
+        w->static_free = e;
+        e = body_next;
+    }
+    w->body_static[body] = -1;
+}
+
+void phys_set_cell_size(struct phys_world *w, float size)
+{
+    if (size < 1e-4f)
+        size = 1e-4f;
+    for (int i = 0; i < w->count; i++)
+        if (w->state[i] == PHYS_SLEEPING)
+            static_remove(w, i);
+    w->cell_size = size;
+    for (int i = 0; i < w->count; i++)
+        if (w->state[i] == PHYS_SLEEPING)
+            static_insert(w, i);
+}
+
+static void update_box(struct phys_world *w, int i)
+{
+    struct vertex *v = w->vertices + i * 3;
+    struct aabb *b = &w->boxes[i];
+    b->minx = b->maxx = v[0].pos[0];
+    b->miny = b->maxy = v[0].pos[1];
+    for (int j = 1; j < 3; j++){
+        if (v[j].pos[0] < b->minx) b->minx = v[j].pos[0];
+        if (v[j].pos[0] > b->maxx) b->maxx = v[j].pos[0];
+        if (v[j].pos[1] < b->miny) b->miny = v[j].pos[1];
+        if (v[j].pos[1] > b->maxy) b->maxy = v[j].pos[1];
+    }
+}
+
+//vertices = R(angle) * local + pos
+static void update_vertices(struct phys_world *w, int i)
+{
+    float s, c;
+    lm_sincosf(w->angle[i], &s, &c);
+    struct vertex *v = w->vertices + i * 3;
+    vec2 *l = w->local + i * 3;
+    for (int j = 0; j < 3; j++){
+        v[j].pos[0] = c * l[j][0] - s * l[j][1] + w->pos[i][0];
+        v[j].pos[1] = s * l[j][0] + c * l[j][1] + w->pos[i][1];
+        memcpy(v[j].vel, w->vel[i], sizeof(vec2));
+    }
+    update_box(w, i);
+    mark_dirty(w, i);
+}
+
+void phys_wake(struct phys_world *w, int i)
+{
+    if (w->state[i] == PHYS_AWAKE)
+        return;
+    static_remove(w, i);
+    w->state[i] = PHYS_AWAKE;
+    w->still[i] = 0;
+    w->awake_slot[i] = w->n_awake;
+    w->awake[w->n_awake++] = i;
+}
+
+static void sleep_body(struct phys_world *w, int i)
+{
+    int slot = w->awake_slot[i];
+    int last = w->awake[--w->n_awake];
+    w->awake[slot] = last;
+    w->awake_slot[last] = slot;
+    w->awake_slot[i] = -1;
+    w->state[i] = PHYS_SLEEPING;
+    w->vel[i][0] = w->vel[i][1] = 0.0f;
+    w->angvel[i] = 0.0f;
+    update_vertices(w, i); //zeroed velocities
+    if (static_insert(w, i) < 0)
+        phys_wake(w, i); //out of memory, keep simulating it
+}
+
+int phys_add_triangle(struct phys_world *w, vec2 a, vec2 b, vec2 c, uint8_t rgb[3])
+{
+    if (w->count >= w->cap)
+        return -1;
+    int i = w->count++;
+    struct vertex *v = w->vertices + i * 3;
+    memset(v, 0, sizeof(struct vertex) * 3);
+    memcpy(v[0].pos, a, sizeof(vec2));
+    memcpy(v[1].pos, b, sizeof(vec2));
+    memcpy(v[2].pos, c, sizeof(vec2));
+    for (int j = 0; j < 3; j++)
+        memcpy(v[j].rgb, rgb, sizeof(uint8_t[3]));
+
+    //unit density, mass is the area
+    vec2 e1, e2;
+    vec2_sub(e1, b, a);
+    vec2_sub(e2, c, a);
+    float area = fabsf(cross2(e1, e2)) * 0.5f;
+    if (area < 1e-8f)
+        area = 1e-8f;
+    w->pos[i][0] = (a[0] + b[0] + c[0]) / 3.0f;
+    w->pos[i][1] = (a[1] + b[1] + c[1]) / 3.0f;
+    float r2 = 0.0f;
+    for (int j = 0; j < 3; j++){
+        vec2_sub(w->local[i * 3 + j], v[j].pos, w->pos[i]);
+        r2 += vec2_mul_inner(w->local[i * 3 + j], w->local[i * 3 + j]);
+    }
+    if (r2 < 1e-12f)
+        r2 = 1e-12f;
+    w->inv_mass[i] = 1.0f / area;
+    w->inv_inertia[i] = 12.0f / (area * r2); //I = m * sum(r^2) / 12
+    w->angle[i] = 0.0f;
+    w->angvel[i] = 0.0f;
+    w->vel[i][0] = w->vel[i][1] = 0.0f;
+    w->body_static[i] = -1;
+    w->state[i] = PHYS_SLEEPING; //so phys_wake() takes it
+    phys_wake(w, i);
+    update_box(w, i);
+    mark_dirty(w, i);
+    return i;
+}
+
+void phys_get_body(const struct phys_world *w, int i, struct phys_body *b)
+{
+    memcpy(b->v, w->vertices + i * 3, sizeof b->v);
+    memcpy(b->pos, w->pos[i], sizeof(vec2));
+    memcpy(b->vel, w->vel[i], sizeof(vec2));
+    b->angle = w->angle[i];
+    b->angvel = w->angvel[i];
+    memcpy(b->local, w->local + i * 3, sizeof b->local);
+    b->inv_mass = w->inv_mass[i];
+    b->inv_inertia = w->inv_inertia[i];
+    b->state = w->state[i];
+}
+
+int phys_add_body(struct phys_world *w, const struct phys_body *b)
+{
+    if (w->count >= w->cap)
+        return -1;
+    int i = w->count++;
+    memcpy(w->vertices + i * 3, b->v, sizeof b->v);
+    memcpy(w->pos[i], b->pos, sizeof(vec2));
+    memcpy(w->vel[i], b->vel, sizeof(vec2));
+    w->angle[i] = b->angle;
+    w->angvel[i] = b->angvel;
+    memcpy(w->local + i * 3, b->local, sizeof b->local);
+    w->inv_mass[i] = b->inv_mass;
+    w->inv_inertia[i] = b->inv_inertia;
+    w->still[i] = 0;
+    w->body_static[i] = -1;
+    w->awake_slot[i] = -1;
+    update_box(w, i);
+    mark_dirty(w, i);
+    w->state[i] = PHYS_SLEEPING;
+    if (b->state == PHYS_SLEEPING){
+        if (static_insert(w, i) == 0)
+            return i;
+        static_remove(w, i);
+    }
+    phys_wake(w, i);
+    return i;
+}
+
+void phys_remove(struct phys_world *w, int i)
+{
+    if (w->state[i] == PHYS_SLEEPING){
+        static_remove(w, i);
+    }
+    else {
+        int slot = w->awake_slot[i];
+        int last = w->awake[--w->n_awake];
+        w->awake[slot] = last;
+        w->awake_slot[last] = slot;
+    }
+    int j = --w->count;
+    if (j != i){
+        memcpy(w->vertices + i * 3, w->vertices + j * 3, sizeof(struct vertex) * 3);
+        w->boxes[i] = w->boxes[j];
+        w->state[i] = w->state[j];
+        memcpy(w->pos[i], w->pos[j], sizeof(vec2));
+        memcpy(w->vel[i], w->vel[j], sizeof(vec2));
+        w->angle[i] = w->angle[j];
+        w->angvel[i] = w->angvel[j];
+        memcpy(w->local + i * 3, w->local + j * 3, sizeof(vec2) * 3);
+        w->inv_mass[i] = w->inv_mass[j];
+        w->inv_inertia[i] = w->inv_inertia[j];
+        w->still[i] = w->still[j];
+        w->awake_slot[i] = w->awake_slot[j];
+        if (w->awake_slot[i] >= 0)
+            w->awake[w->awake_slot[i]] = i;
+        w->body_static[i] = w->body_static[j];
+        int k = w->state[i] == PHYS_SLEEPING && w->body_static[i] < 0 ? static_big_slot(w, j) : -1;
+        if (k >= 0)
+            w->static_big[k] = i;
+        for (int e = w->body_static[i]; e >= 0; e = w->static_entries[e].body_next)
+            w->static_entries[e].body = i;
+        mark_dirty(w, i);
+    }
+    if (w->dirty_hi > w->count)
+        w->dirty_hi = w->count;
+    if (w->dirty_lo >= w->dirty_hi)
+        w->dirty_lo = w->dirty_hi = 0;
+    //keys hold body indices, the next step starts cold
+    if (w->warm_used){
+        memset(w->warm, 0, sizeof(struct phys_warm) * w->warm_cap);
+        w->warm_used = 0;
+    }
+}
+
+int phys_restore(struct phys_world *w, int count)
+{
+    if (count < 0 || count > w->cap)
+        return -1;
+    phys_clear(w);
+    w->count = count;
+    for (int i = 0; i < count; i++){
+        w->still[i] = 0;
+        w->body_static[i] = -1;
+        w->awake_slot[i] = -1;
+        update_box(w, i);
+        if (w->state[i] == PHYS_SLEEPING){
+            if (static_insert(w, i) == 0)
+                continue;
+            static_remove(w, i); //out of memory, simulate it instead
+        }
+        w->state[i] = PHYS_AWAKE;
+        w->awake_slot[i] = w->n_awake;
+        w->awake[w->n_awake++] = i;
+    }
+    w->dirty_lo = 0;
+    w->dirty_hi = count;
+    return 0;
+}
+
+static int push_pair(struct phys_world *w, int a, int b)
+{
+    if (grow((void **) &w->pairs, &w->pairs_cap, w->n_pairs + 1, sizeof(struct phys_pair)) < 0)
+        return -1;
+    w->pairs[w->n_pairs].a = a;
+    w->pairs[w->n_pairs].b = b;
+    w->n_pairs++;
+    return 0;
+}
+
+int phys_broadphase(struct phys_world *w)
+{
+    float inv_cell = 1.0f / w->cell_size;
+    w->n_pairs = 0;
+    w->n_entries = 0;
+    w->n_awake_big = 0;
+    w->stats.pairs = 0;
+    if (!w->n_awake)
+        return 0;
+
+    for (int k = 0; k < w->n_awake; k++){
+        int i = w->awake[k];
+        int x0, x1, y0, y1;
+        if (box_cells(&w->boxes[i], inv_cell, &x0, &x1, &y0, &y1)){
+            w->awake_big[w->n_awake_big++] = i;
+            continue;
+        }
+        for (int m = 0; m < w->n_static_big; m++){
+            int b = w->static_big[m];
+            if (boxes_overlap(&w->boxes[i], &w->boxes[b]) && push_pair(w, i, b) < 0)
+                return -1;
+        }
+        int need = w->n_entries + (x1 - x0 + 1) * (y1 - y0 + 1);
+        if (grow((void **) &w->entries, &w->entries_cap, need, sizeof(struct phys_cell_entry)) < 0)
+            return -1;
+        for (int y = y0; y <= y1; y++){
+            for (int x = x0; x <= x1; x++){
+                struct phys_cell_entry *e = &w->entries[w->n_entries++];
+                e->ix = x;
+                e->iy = y;
+                e->body = i;
+
+                //awake vs sleeping, straight from the persistent grid
+                int se = w->static_head[bucket_of(x, y, w->n_static_buckets)];
+                for (; se >= 0; se = w->static_entries[se].next){
+                    struct phys_static_entry *s = &w->static_entries[se];
+                    if (s->ix != x || s->iy != y)
+                        continue;
+                    if (!boxes_overlap(&w->boxes[i], &w->boxes[s->body]) ||
+                        !owns_pair(&w->boxes[i], &w->boxes[s->body], x, y, inv_cell))
+                        continue;
+                    if (push_pair(w, i, s->body) < 0)
+                        return -1;
+                }
+            }
+        }
+    }
+
+    //awake vs awake: counting sort of entries into hash buckets
+    int n_buckets = 1;
+    while (n_buckets < w->n_entries * 2)
+        n_buckets *= 2;
+    if (n_buckets != w->n_buckets){
+        int *p = realloc(w->bucket_start, sizeof(int) * (n_buckets + 1));
+        if (!p)
+            return -1;
+        w->bucket_start = p;
+        w->n_buckets = n_buckets;
+    }
+    struct phys_cell_entry *sorted = realloc(w->sorted, sizeof(struct phys_cell_entry) * w->entries_cap);
+    if (!sorted)
+        return -1;
+    w->sorted = sorted;
+
+    int *start = w->bucket_start;
+    memset(start, 0, sizeof(int) * (n_buckets + 1));
+    for (int i = 0; i < w->n_entries; i++)
+        start[bucket_of(w->entries[i].ix, w->entries[i].iy, n_buckets) + 1]++;
+    for (int i = 0; i < n_buckets; i++)
+        start[i + 1] += start[i];
+    for (int i = 0; i < w->n_entries; i++){
+        unsigned bk = bucket_of(w->entries[i].ix, w->entries[i].iy, n_buckets);
+        sorted[start[bk]++] = w->entries[i];
+    }
+    //start[bk] now holds the end of bucket bk, shift back
+    for (int i = n_buckets; i > 0; i--)
+        start[i] = start[i - 1];
+    start[0] = 0;
+
+    for (int bk = 0; bk < n_buckets; bk++){
+        for (int i = start[bk]; i < start[bk + 1]; i++){
+            struct phys_cell_entry *ea = &sorted[i];
+            for (int j = i + 1; j < start[bk + 1]; j++){
+                struct phys_cell_entry *eb = &sorted[j];
+                int a = ea->body, b = eb->body;
+                if (ea->ix != eb->ix || ea->iy != eb->iy || a == b)
+                    continue;
+                struct aabb *ba = &w->boxes[a], *bb = &w->boxes[b];
+                if (!boxes_overlap(ba, bb) || !owns_pair(ba, bb, ea->ix, ea->iy, inv_cell))
+                    continue;
+                if (push_pair(w, a, b) < 0)
+                    return -1;
+            }
+        }
+    }
+
+    //oversized awake bodies against every body, two of them pair up from
+    //the lower index
+    for (int m = 0; m < w->n_awake_big; m++){
+        int i = w->awake_big[m];
+        for (int j = 0; j < w->count; j++){
+            if (j == i || !boxes_overlap(&w->boxes[i], &w->boxes[j]))
+                continue;
+            int x0, x1, y0, y1;
+            if (w->state[j] == PHYS_AWAKE && j < i && box_cells(&w->boxes[j], inv_cell, &x0, &x1, &y0, &y1))
+                continue;
+            if (push_pair(w, i, j) < 0)
+                return -1;
+        }
+    }
+    w->stats.pairs = w->n_pairs;
+    return w->n_pairs;
+}
+
+static void project(const struct vertex *v, vec2 axis, float *min, float *max)
+{
+    *min = *max = vec2_mul_inner(v[0].pos, axis);
+    for (int i = 1; i < 3; i++){
+        float p = vec2_mul_inner(v[i].pos, axis);
+        if (p < *min) *min = p;
+        if (p > *max) *max = p;
+    }
+}
+
+/*
+ * separating axis test. on overlap n is the unit normal pushing a out of b,
+ * depth the overlap along it, and *ref tells which triangle owns the axis
+ * (0: a, 1: b); the other one is the incident triangle.
+ */
+static int tri_overlap(const struct vertex *a, const struct vertex *b, vec2 n, float *depth, int *ref)
+{
+    float best = INFINITY;
+    for (int t = 0; t < 2; t++){
+        const struct vertex *s = t ? b : a;
+        for (int i = 0; i < 3; i++){
+            vec2 edge, axis;
+            vec2_sub(edge, s[(i + 1) % 3].pos, s[i].pos);
+            axis[0] = -edge[1];
+            axis[1] = edge[0];
+            float len2 = vec2_mul_inner(axis, axis);
+            if (len2 < 1e-12f)
+                continue;
+            vec2_scale(axis, axis, lm_rsqrt(len2));
+            float amin, amax, bmin, bmax;
+            project(a, axis, &amin, &amax);
+            project(b, axis, &bmin, &bmax);
+            float o = (amax < bmax ? amax : bmax) - (amin > bmin ? amin : bmin);
+            if (o <= 0.0f)
+                return 0;
+            if (o < best){
+                best = o;
+                n[0] = axis[0];
+                n[1] = axis[1];
+                *ref = t;
+            }
+        }
+    }
+    vec2 d = {0.0f, 0.0f};
+    for (int i = 0; i < 3; i++){
+        d[0] += a[i].pos[0] - b[i].pos[0];
+        d[1] += a[i].pos[1] - b[i].pos[1];
+    }
+    if (vec2_mul_inner(d, n) < 0.0f)
+        vec2_scale(n, n, -1.0f);
+    *depth = best;
+    return 1;
+}
+
+static inline uint64_t contact_key(int inc, int ref, int vertex)
+{
+    return ((uint64_t) inc << 34 | (uint64_t) (uint32_t) (ref + 1) << 2 | vertex) + 1;
+}
+
+static inline unsigned warm_slot(uint64_t key, int cap)
+{
+    return (unsigned) ((key * 0x9E3779B97F4A7C15ULL) >> 32) & (cap - 1);
+}
+
+//flip tells that the stored tangent impulse is measured the other way round
+static int push_contact(struct phys_world *w, int a, int b, vec2 p, vec2 n, float depth, uint64_t key, int flip)
+{
+    if (grow((void **) &w->contacts, &w->contacts_cap, w->n_contacts + 1, sizeof(struct phys_contact)) < 0)
+        return -1;
+    struct phys_contact *c = &w->contacts[w->n_contacts++];
+    c->a = a;
+    c->b = b;
+    memcpy(c->point, p, sizeof(vec2));
+    memcpy(c->normal, n, sizeof(vec2));
+    c->depth = depth;
+    c->jn = c->jt = 0.0f;
+    c->key = key;
+    if (!w->warm_cap)
+        return 0;
+    for (unsigned s = warm_slot(key, w->warm_cap); w->warm[s].key; s = (s + 1) & (w->warm_cap - 1)){
+        if (w->warm[s].key == key){
+            c->jn = w->warm[s].jn;
+            c->jt = flip ? -w->warm[s].jt : w->warm[s].jt;
+            break;
+        }
+    }
+    return 0;
+}
+
+//remember this step's impulses, keyed so the next step can find them
+static void store_warm(struct phys_world *w)
+{
+    if (!w->n_contacts && !w->warm_used)
+        return;
+    int cap = 1;
+    while (cap < w->n_contacts * 2)
+        cap *= 2;
+    //shrinks too, clearing the table must stay proportional to the contacts
+    if (cap > w->warm_cap || cap * 4 < w->warm_cap){
+        struct phys_warm *p = realloc(w->warm, sizeof(struct phys_warm) * cap);
+        if (!p)
+            return;
+        w->warm = p;
+        w->warm_cap = cap;
+    }
+    memset(w->warm, 0, sizeof(struct phys_warm) * w->warm_cap);
+    w->warm_used = w->n_contacts;
+    for (int k = 0; k < w->n_contacts; k++){
+        struct phys_contact *c = &w->contacts[k];
+        int flip = c->b >= 0 && (c->key >> 34) != (uint64_t) c->a;
+        unsigned s = warm_slot(c->key, w->warm_cap);
+        while (w->warm[s].key)
+            s = (s + 1) & (w->warm_cap - 1);
+        w->warm[s].key = c->key;
+        w->warm[s].jn = c->jn;
+        w->warm[s].jt = flip ? -c->jt : c->jt;
+    }
+}
+
+static int touching(struct phys_world *w, int a, int b)
+{
+    vec2 n;
+    float depth;
+    int ref;
+    return boxes_overlap(&w->boxes[a], &w->boxes[b]) &&
+           tri_overlap(w->vertices + a * 3, w->vertices + b * 3, n, &depth, &ref);
+}
+
+//wakes every sleeper overlapping a body from awake[first] on, and in turn
+//the ones overlapping those, so a woken body takes what rests on it along
+static void wake_touching(struct phys_world *w, int first)
+{
+    float inv_cell = 1.0f / w->cell_size;
+    for (int k = first; k < w->n_awake; k++){
+        int i = w->awake[k];
+        int x0, x1, y0, y1;
+        if (box_cells(&w->boxes[i], inv_cell, &x0, &x1, &y0, &y1)){
+            for (int b = 0; b < w->count; b++)
+                if (w->state[b] == PHYS_SLEEPING && touching(w, i, b))
+                    phys_wake(w, b);
+            continue;
+        }
+        for (int m = 0; m < w->n_static_big;){
+            if (touching(w, i, w->static_big[m]))
+                phys_wake(w, w->static_big[m]); //moves the last one into m
+            else
+                m++;
+        }
+        for (int y = y0; y <= y1; y++){
+            for (int x = x0; x <= x1; x++){
+                unsigned bk = bucket_of(x, y, w->n_static_buckets);
+                int se = w->static_head[bk];
+                while (se >= 0){
+                    struct phys_static_entry *s = &w->static_entries[se];
+                    if (s->ix == x && s->iy == y && touching(w, i, s->body)){
+                        phys_wake(w, s->body);
+                        se = w->static_head[bk]; //waking unlinked b's entries
+                    }
+                    else {
+                        se = s->next;
+                    }
+                }
+            }
+        }
+    }
+}
+
+//sleepers hit hard enough wake before any contact is made, so they move this
+//step already. 1 if the awake set changed and the pairs are stale
+static int wake_hit(struct phys_world *w)
+{
+    int first = w->n_awake;
+    for (int k = 0; k < w->n_pairs; k++){
+        int a = w->pairs[k].a, b = w->pairs[k].b, ref;
+        vec2 n, rel;
+        float depth;
+        if (w->state[b] != PHYS_SLEEPING ||
+            !tri_overlap(w->vertices + a * 3, w->vertices + b * 3, n, &depth, &ref))
+            continue;
+        vec2_sub(rel, w->vel[a], w->vel[b]);
+        if (-vec2_mul_inner(rel, n) > WAKE_SPEED)
+            phys_wake(w, b);
+    }
+    if (w->n_awake == first)
+        return 0;
+    wake_touching(w, first);
+    return 1;
+}
+
+int phys_narrowphase(struct phys_world *w)
+{
+    w->n_contacts = 0;
+    if (wake_hit(w) && phys_broadphase(w) < 0)
+        return -1;
+    for (int k = 0; k < w->n_awake; k++){
+        int i = w->awake[k];
+        if (w->boxes[i].miny >= w->floor_y)
+            continue;
+        struct vertex *v = w->vertices + i * 3;
+        for (int j = 0; j < 3; j++)
+            if (v[j].pos[1] < w->floor_y)
+                push_contact(w, i, -1, v[j].pos, (vec2){0.0f, 1.0f}, w->floor_y - v[j].pos[1],
+                             contact_key(i, -1, j), 0);
+    }
+
+    for (int k = 0; k < w->n_pairs; k++){
+        int a = w->pairs[k].a, b = w->pairs[k].b;
+        struct vertex *va = w->vertices + a * 3, *vb = w->vertices + b * 3;
+        vec2 n;
+        float depth;
+        int ref = 0;
+        if (!tri_overlap(va, vb, n, &depth, &ref))
+            continue;
+        //contact points are the incident vertices inside the reference triangle's slab
+        struct vertex *inc = ref ? va : vb;
+        struct vertex *rf  = ref ? vb : va;
+        float sign = ref ? 1.0f : -1.0f; //direction pushing inc out of rf
+        float rmin, rmax;
+        vec2 dir;
+        vec2_scale(dir, n, sign);
+        project(rf, dir, &rmin, &rmax);
+        int inc_body = ref ? a : b, ref_body = ref ? b : a;
+        for (int j = 0; j < 3; j++){
+            float p = vec2_mul_inner(inc[j].pos, dir);
+            if (p < rmax && p > rmin)
+                push_contact(w, a, b, inc[j].pos, n, rmax - p < depth ? rmax - p : depth,
+                             contact_key(inc_body, ref_body, j), !ref);
+        }
+    }
+    w->stats.contacts = w->n_contacts;
+    return w->n_contacts;
+}
+
+static void apply_impulse(struct phys_world *w, int i, vec2 r, vec2 p)
+{
+    w->vel[i][0] += p[0] * w->inv_mass[i];
+    w->vel[i][1] += p[1] * w->inv_mass[i];
+    w->angvel[i] += cross2(r, p) * w->inv_inertia[i];
+}
+
+static void point_velocity(struct phys_world *w, int i, vec2 r, vec2 out)
+{
+    out[0] = w->vel[i][0] - w->angvel[i] * r[1];
+    out[1] = w->vel[i][1] + w->angvel[i] * r[0];
+}
+
+static int island_root(int *up, int i)
+{
+    while (up[i] >= 0){
+        if (up[up[i]] >= 0)
+            up[i] = up[up[i]];
+        i = up[i];
+    }
+    return i;
+}
+
+void phys_solve(struct phys_world *w, float dt)
+{
+    w->stats.moving = w->n_awake;
+    if (!w->n_awake)
+        return;
+    for (int k = 0; k < w->n_awake; k++)
+        w->vel[w->awake[k]][1] -= w->gravity * dt;
+
+    //warm start with last step's impulses
+    for (int k = 0; k < w->n_contacts; k++){
+        struct phys_contact *c = &w->contacts[k];
+        if (c->jn == 0.0f && c->jt == 0.0f)
+            continue;
+        int b_dyn = c->b >= 0 && w->state[c->b] == PHYS_AWAKE;
+        vec2 ra, rb, p;
+        p[0] = c->normal[0] * c->jn - c->normal[1] * c->jt;
+        p[1] = c->normal[1] * c->jn + c->normal[0] * c->jt;
+        vec2_sub(ra, c->point, w->pos[c->a]);
+        apply_impulse(w, c->a, ra, p);
+        if (b_dyn){
+            vec2_sub(rb, c->point, w->pos[c->b]);
+            apply_impulse(w, c->b, rb, (vec2){-p[0], -p[1]});
+        }
+    }
+
+    //sequential impulses, sleeping bodies and the floor are immovable
+    for (int it = 0; it < SOLVER_ITERATIONS; it++){
+        for (int k = 0; k < w->n_contacts; k++){
+            struct phys_contact *c = &w->contacts[k];
+            int a = c->a, b = c->b;
+            int b_dyn = b >= 0 && w->state[b] == PHYS_AWAKE;
+            vec2 ra, rb = {0.0f, 0.0f}, va, vb = {0.0f, 0.0f}, rel, t, p;
+            vec2_sub(ra, c->point, w->pos[a]);
+            point_velocity(w, a, ra, va);
+            if (b_dyn){
+                vec2_sub(rb, c->point, w->pos[b]);
+                point_velocity(w, b, rb, vb);
+            }
+            vec2_sub(rel, va, vb);
+
+            float rna = cross2(ra, c->normal), rnb = cross2(rb, c->normal);
+            float kn = w->inv_mass[a] + rna * rna * w->inv_inertia[a];
+            if (b_dyn)
+                kn += w->inv_mass[b] + rnb * rnb * w->inv_inertia[b];
+            float dj = -vec2_mul_inner(rel, c->normal) / kn;
+            float jn = c->jn + dj > 0.0f ? c->jn + dj : 0.0f;
+            dj = jn - c->jn;
+            c->jn = jn;
+            vec2_scale(p, c->normal, dj);
+            apply_impulse(w, a, ra, p);
+            if (b_dyn)
+                apply_impulse(w, b, rb, (vec2){-p[0], -p[1]});
+
+            //friction, recomputed with the updated velocities
+            point_velocity(w, a, ra, va);
+            if (b_dyn)
+                point_velocity(w, b, rb, vb);
+            vec2_sub(rel, va, vb);
+            t[0] = -c->normal[1];
+            t[1] = c->normal[0];
+            float rta = cross2(ra, t), rtb = cross2(rb, t);
+            float kt = w->inv_mass[a] + rta * rta * w->inv_inertia[a];
+            if (b_dyn)
+                kt += w->inv_mass[b] + rtb * rtb * w->inv_inertia[b];
+            float djt = -vec2_mul_inner(rel, t) / kt;
+            float max_jt = FRICTION * c->jn;
+            float jt = c->jt + djt;
+            jt = jt > max_jt ? max_jt : jt < -max_jt ? -max_jt : jt;
+            djt = jt - c->jt;
+            c->jt = jt;
+            vec2_scale(p, t, djt);
+            apply_impulse(w, a, ra, p);
+            if (b_dyn)
+                apply_impulse(w, b, rb, (vec2){-p[0], -p[1]});
+        }
+    }
+
+    for (int k = 0; k < w->n_awake; k++){
+        int i = w->awake[k];
+        w->pos[i][0] += w->vel[i][0] * dt;
+        w->pos[i][1] += w->vel[i][1] * dt;
+        w->angle[i] += w->angvel[i] * dt;
+    }
+
+    //push overlaps apart on positions only, so resolving penetration
+    //never feeds energy back into the velocities
+    for (int k = 0; k < w->n_contacts; k++){
+        struct phys_contact *c = &w->contacts[k];
+        int a = c->a, b = c->b;
+        int b_dyn = b >= 0 && w->state[b] == PHYS_AWAKE;
+        if (c->depth <= SLOP)
+            continue;
+        float total = w->inv_mass[a] + (b_dyn ? w->inv_mass[b] : 0.0f);
+        float d = CORRECTION * (c->depth - SLOP) / total;
+        w->pos[a][0] += c->normal[0] * d * w->inv_mass[a];
+        w->pos[a][1] += c->normal[1] * d * w->inv_mass[a];
+        if (b_dyn){
+            w->pos[b][0] -= c->normal[0] * d * w->inv_mass[b];
+            w->pos[b][1] -= c->normal[1] * d * w->inv_mass[b];
+        }
+    }
+
+    for (int k = 0; k < w->n_awake; k++){
+        int i = w->awake[k];
+        update_vertices(w, i);
+
+        int slow = vec2_mul_inner(w->vel[i], w->vel[i]) < SLEEP_LINEAR * SLEEP_LINEAR &&
+                   fabsf(w->angvel[i]) < SLEEP_ANGULAR;
+        w->still[i] = slow ? w->still[i] + 1 : 0;
+    }
+    store_warm(w);
+
+    //bodies touching each other sleep together or not at all, so none is
+    //left resting on a body that still moves. islands are union find trees
+    //over the awake contacts, a root holds -1, or -2 once a member is not
+    //still yet
+    int *up = w->island;
+    for (int k = 0; k < w->n_awake; k++)
+        up[w->awake[k]] = -1;
+    for (int k = 0; k < w->n_contacts; k++){
+        struct phys_contact *c = &w->contacts[k];
+        if (c->b < 0 || w->state[c->b] != PHYS_AWAKE)
+            continue;
+        int ra = island_root(up, c->a), rb = island_root(up, c->b);
+        if (ra == rb)
+            continue;
+        if (up[rb] < up[ra])
+            up[ra] = up[rb];
+        up[rb] = ra;
+    }
+    for (int k = 0; k < w->n_awake; k++){
+        int i = w->awake[k];
+        if (w->still[i] < SLEEP_STEPS)
+            up[island_root(up, i)] = -2;
+    }
+    //separate pass, sleep_body() reorders the awake list
+    for (int k = w->n_awake - 1; k >= 0; k--){
+        int i = w->awake[k];
+        if (up[island_root(up, i)] == -1)
+            sleep_body(w, i);
+    }
+}
+
+void phys_step(struct phys_world *w, float dt)
+{
+    if (!w->n_awake){
+        memset(&w->stats, 0, sizeof w->stats);
+        return;
+    }
+    {
+        PROF_ZONE("broadphase");
+        phys_broadphase(w);
+    }
+    {
+        PROF_ZONE("narrowphase");
+        phys_narrowphase(w);
+    }
+    PROF_ZONE("solve");
+    phys_solve(w, dt);
+}
@@ -0,0 +1,167 @@
+#ifndef PHYS_H
+#define PHYS_H
+
+#include <stdint.h>
+#include "lin.h"
+
+/*
+ * 2d rigid body simulation of triangles shared by tri2.c and stack_bench.c.
+ * vertices are laid out exactly as uploaded to GL (stride 20) and are only
+ * rewritten for awake bodies.
+ *
+ * awake bodies are integrated through the awake list and paired through a
+ * hashed uniform grid rebuilt every step with a counting sort. sleeping
+ * bodies live in a persistent hash grid that only changes when a body falls
+ * asleep or wakes up; awake bodies query it, sleeping pairs are never
+ * looked at. a scene where everything sleeps costs nothing per step.
+ */
+
+struct vertex{
+    vec2 pos;
+    vec2 vel;
+    uint8_t rgb[3];
+};
+
+//one body with everything needed to put it back, the unit stream.c pages
+struct phys_body{
+    struct vertex v[3];
+    vec2 pos;
+    vec2 vel;
+    float angle;
+    float angvel;
+    vec2 local[3];
+    float inv_mass;
+    float inv_inertia;
+    uint32_t state;
+};
+
+struct aabb{
+    float minx, miny, maxx, maxy;
+};
+
+struct phys_pair{
+    int a, b; //a is always awake
+};
+
+struct phys_contact{
+    int a, b;     //b == -1 for the floor
+    vec2 point;
+    vec2 normal;  //points from b to a
+    float depth;
+    float jn, jt; //accumulated impulses
+    uint64_t key; //(incident body, reference body, vertex), stable across steps
+};
+
+//impulses of the previous step, to warm start matching contacts
+struct phys_warm{
+    uint64_t key; //0 is empty
+    float jn, jt;
+};
+
+enum phys_body_state{
+    PHYS_AWAKE,
+    PHYS_SLEEPING,
+};
+
+//one per (cell, awake body) overlap, rebuilt every step
+struct phys_cell_entry{
+    int ix, iy;
+    int body;
+};
+
+//one per (cell, sleeping body) overlap, linked into a bucket and into its body
+struct phys_static_entry{
+    int ix, iy;
+    int body;
+    int prev, next;
+    int body_next;
+};
+
+struct phys_world{
+    int count; //triangles
+    int cap;
+    float floor_y;
+    float gravity;
+    float cell_size;
+    int dirty_lo, dirty_hi; //triangles whose vertices changed, [lo, hi)
+
+    struct vertex *vertices; //count * 3
+    struct aabb *boxes;
+    uint8_t *state;
+
+    //per body, centroid frame
+    vec2 *pos;
+    vec2 *vel;
+    float *angle;
+    float *angvel;
+    vec2 *local;     //3 per body, vertex offsets at angle 0
+    float *inv_mass;
+    float *inv_inertia;
+    uint16_t *still; //consecutive slow steps
+
+    int *awake;
+    int *awake_slot; //index into awake, -1 while sleeping
+    int *island;     //scratch of the sleep pass, per body
+    int n_awake;
+
+    //awake broadphase
+    int n_buckets;           //power of 2
+    int *bucket_start;       //n_buckets + 1
+    struct phys_cell_entry *entries;
+    struct phys_cell_entry *sorted;
+    int n_entries;
+    int entries_cap;
+    int *awake_big;          //awake bodies too big for the grid, this step
+    int n_awake_big;
+
+    //sleeping broadphase
+    int n_static_buckets;
+    int *static_head;
+    int *body_static; //first static entry of a body, -1 if none
+    struct phys_static_entry *static_entries;
+    int static_cap;
+    int static_free;
+    int *static_big; //sleeping bodies left out of the grid for their size
+    int n_static_big;
+
+    struct phys_pair *pairs;
+    int n_pairs;
+    int pairs_cap;
+    struct phys_contact *contacts;
+    int n_contacts;
+    int contacts_cap;
+    struct phys_warm *warm;
+    int warm_cap; //power of 2
+    int warm_used;
+
+    struct {
+        int pairs;    //broadphase candidates
+        int contacts; //contact points
+        int moving;   //awake bodies
+    } stats;
+};
+
+int  phys_init(struct phys_world *w, int cap);
+void phys_free(struct phys_world *w);
+//returns the triangle index or -1 if full
+int  phys_add_triangle(struct phys_world *w, vec2 a, vec2 b, vec2 c, uint8_t rgb[3]);
+void phys_clear(struct phys_world *w);
+void phys_set_cell_size(struct phys_world *w, float size);
+void phys_wake(struct phys_world *w, int i);
+void phys_clear_dirty(struct phys_world *w);
+void phys_get_body(const struct phys_world *w, int i, struct phys_body *b);
+//returns the new index or -1 if full
+int  phys_add_body(struct phys_world *w, const struct phys_body *b);
+//moves the last body into i and drops warm starting, only between steps
+void phys_remove(struct phys_world *w, int i);
+//rebuilds boxes, the awake list and the sleeping grid after the per-body
+//arrays of [0, count) were filled directly, e.g. by scene.c
+int  phys_restore(struct phys_world *w, int count);
+
+//phys_step() = phys_broadphase() + phys_narrowphase() + phys_solve()
+void phys_step(struct phys_world *w, float dt);
+int  phys_broadphase(struct phys_world *w);
+int  phys_narrowphase(struct phys_world *w);
+void phys_solve(struct phys_world *w, float dt);
+
+#endif
@@ -0,0 +1,208 @@
+#include "prof.h"
+
+#ifdef PROF_ENABLED
+
+#include <SDL.h>
+#include "common.h"
+#include "glad/glad.h"
+
+#ifndef GL_TIMESTAMP
+#define GL_TIMESTAMP 0x8E28
+#endif
+
+typedef void (APIENTRYP PFNGLQUERYCOUNTERPROC)(GLuint id, GLenum target);
+typedef void (APIENTRYP PFNGLGETQUERYOBJECTUI64VPROC)(GLuint id, GLenum pname, GLuint64 *params);
+
+struct prof_event{
+    const char *name;
+    uint64_t t0, t1;
+};
+
+struct prof_thread{
+    struct prof_thread *next;
+    const char *name;
+    int tid;
+    int gpu;      //times are GL nanoseconds, not prof_now() ticks
+    uint64_t n;   //events ever pushed, the ring keeps the last PROF_EVENTS
+    struct prof_event ev[PROF_EVENTS];
+};
+
+static struct prof_thread *threads; //push only, linked with CAS
+static SDL_atomic_t next_tid;
+static _Thread_local struct prof_thread *self;
+static uint64_t tick0, qpc0;
+
+static struct {
+    int ok;
+    PFNGLQUERYCOUNTERPROC query_counter;
+    PFNGLGETQUERYOBJECTUI64VPROC get_ui64;
+    GLuint queries[PROF_GPU_MAX * 2];
+    const char *name[PROF_GPU_MAX];
+    char ended[PROF_GPU_MAX];
+    int head, tail; //begin order, results come back in the same order
+    uint64_t cal_ns;   //GL_TIMESTAMP and prof_now() read back to back
+    uint64_t cal_tick;
+    struct prof_thread *track;
+} gpu;
+
+static struct prof_thread *new_track(const char *name)
+{
+    struct prof_thread *t = calloc(1, sizeof *t);
+    if (!t)
+        return NULL;
+    t->name = name;
+    t->tid = SDL_AtomicAdd(&next_tid, 1) + 1;
+    do {
+        t->next = SDL_AtomicGetPtr((void **) &threads);
+    } while (!SDL_AtomicCASPtr((void **) &threads, t->next, t));
+    return t;
+}
+
+void prof_init(void)
+{
+    tick0 = prof_now();
+    qpc0 = SDL_GetPerformanceCounter();
+}
+
+void prof_thread_name(const char *name)
+{
+    if (!self)
+        self = new_track(name);
+    else
+        self->name = name;
+}
+
+static void push(struct prof_thread *t, const char *name, uint64_t t0, uint64_t t1)
+{
+    struct prof_event *e = &t->ev[t->n & (PROF_EVENTS - 1)];
+    e->name = name;
+    e->t0 = t0;
+    e->t1 = t1;
+    t->n++;
+}
+
+void prof_push(const char *name, uint64_t t0, uint64_t t1)
+{
+    if (!self && !(self = new_track("thread")))
+        return;
+    push(self, name, t0, t1);
+}
+
+int prof_gpu_init(void *(*get_proc)(const char *))
+{
+    //the dlsym idiom, ISO C has no object to function pointer cast
+    *(void **) &gpu.query_counter = get_proc("glQueryCounter");
+    *(void **) &gpu.get_ui64 = get_proc("glGetQueryObjectui64v");
+    if (!gpu.query_counter || !gpu.get_ui64 || !(gpu.track = new_track("gpu")))
+        return -1;
+    gpu.track->gpu = 1;
+    glGenQueries(PROF_GPU_MAX * 2, gpu.queries);
+    GLint64 now;
+    glGetInteger64v(GL_TIMESTAMP, &now);
+    gpu.cal_tick = prof_now();
+    gpu.cal_ns = now;
+    gpu.ok = glGetError() == GL_NO_ERROR;
+    return gpu.ok ? 0 : -1;
+}
+
+int prof_gpu_begin(const char *name)
+{
+    if (!gpu.ok || (gpu.head + 1) % PROF_GPU_MAX == gpu.tail)
+        return -1;
+    int z = gpu.head;
+    gpu.head = (z + 1) % PROF_GPU_MAX;
+    gpu.name[z] = name;
+    gpu.ended[z] = 0;
+    gpu.query_counter(gpu.queries[z * 2], GL_TIMESTAMP);
+    return z;
+}
+
+void prof_gpu_end(int z)
+{
+    if (z < 0)
+        return;
+    gpu.query_counter(gpu.queries[z * 2 + 1], GL_TIMESTAMP);
+    gpu.ended[z] = 1;
+}
+
+void prof_gpu_push(const char *name, uint64_t t0, uint64_t t1)
+{
+    if (gpu.ok)
+        push(gpu.track, name, t0, t1);
+}
+
+void prof_frame(void)
+{
+    while (gpu.ok && gpu.tail != gpu.head && gpu.ended[gpu.tail]){
+        int z = gpu.tail;
+        GLint ready = 0;
+        //the end stamp was issued last, once it is there both are
+        glGetQueryObjectiv(gpu.queries[z * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (!ready)
+            break;
+        GLuint64 t0, t1;
+        gpu.get_ui64(gpu.queries[z * 2], GL_QUERY_RESULT, &t0);
+        gpu.get_ui64(gpu.queries[z * 2 + 1], GL_QUERY_RESULT, &t1);
+        push(gpu.track, gpu.name[z], t0, t1);
+        gpu.tail = (z + 1) % PROF_GPU_MAX;
+    }
+}
+
+static void write_name(FILE *f, const char *s)
+{
+    for (; *s; s++){
+        if (*s == '"' || *s == '\\')
+            fputc('\\', f);
+        fputc(*s, f);
+    }
+}
+
+int prof_write_chrome(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return -1;
+    //rdtsc ticks to microseconds, measured over the whole run
+    double ticks_per_us = 1.0;
+    uint64_t dq = SDL_GetPerformanceCounter() - qpc0;
+    if (dq)
+        ticks_per_us = (double) (prof_now() - tick0) / dq * SDL_GetPerformanceFrequency() / 1e6;
+    double gpu_base_us = ((double) gpu.cal_tick - tick0) / ticks_per_us;
+
+    fprintf(f, "{\"traceEvents\":[\n");
+    int first = 1;
+    for (struct prof_thread *t = SDL_AtomicGetPtr((void **) &threads); t; t = t->next){
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"",
+                first ? "" : ",\n", t->tid);
+        write_name(f, t->name);
+        fprintf(f, "\"}}");
+        first = 0;
+        uint64_t n = t->n, start = n > PROF_EVENTS ? n - PROF_EVENTS : 0;
+        for (uint64_t i = start; i < n; i++){
+            struct prof_event *e = &t->ev[i & (PROF_EVENTS - 1)];
+            double ts, dur;
+            if (t->gpu){
+                ts = gpu_base_us + ((double) e->t0 - gpu.cal_ns) / 1000.0;
+                dur = (double) (e->t1 - e->t0) / 1000.0;
+            }
+            else {
+                ts = ((double) e->t0 - tick0) / ticks_per_us;
+                dur = (double) (e->t1 - e->t0) / ticks_per_us;
+            }
+            fprintf(f, ",\n{\"name\":\"");
+            write_name(f, e->name);
+            fprintf(f, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", t->tid, ts, dur);
+        }
+    }
+    fprintf(f, "\n]}\n");
+    int err = ferror(f);
+    if (fclose(f) != 0 || err)
+        return -1;
+    return 0;
+}
+
+#else
+
+typedef int prof_disabled; //ISO C wants something in every translation unit
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdint.h>
+
+/*
+ * scoped timing zones, exported as chrome trace-event json
+ * (chrome://tracing, ui.perfetto.dev). build with make PROF=1, otherwise
+ * every macro and call below compiles to nothing.
+ *
+ *     PROF_ZONE("update");       //until the end of the enclosing block
+ *     PROF_GPU_ZONE("triangles"); //GL timestamps, read back frames later
+ *
+ * each thread appends to its own ring, only the owning thread writes it and
+ * registration is a single CAS, so recording takes no locks. when a ring is
+ * full the oldest events are overwritten. zone names must outlive the
+ * export, string literals in practice.
+ */
+
+#ifdef PROF_ENABLED
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t prof_now(void)
+{
+    return __rdtsc();
+}
+#else
+#include <SDL.h>
+static inline uint64_t prof_now(void)
+{
+    return SDL_GetPerformanceCounter();
+}
+#endif
+
+#define PROF_EVENTS  65536 //per thread, power of 2
+#define PROF_GPU_MAX 256   //gpu zones in flight
+
+struct prof_scope{
+    const char *name;
+    uint64_t t0;
+};
+
+void prof_init(void);
+void prof_thread_name(const char *name);
+void prof_push(const char *name, uint64_t t0, uint64_t t1);
+
+//loads the timer query entry points, a GL context must be current.
+//returns -1 when the driver has no timestamps, gpu zones are then dropped
+int  prof_gpu_init(void *(*get_proc)(const char *));
+int  prof_gpu_begin(const char *name);
+void prof_gpu_end(int zone);
+//a gpu zone timed elsewhere (gputime), GL_TIMESTAMP nanoseconds
+void prof_gpu_push(const char *name, uint64_t t0, uint64_t t1);
+//once per frame, picks up gpu results that are ready without waiting
+void prof_frame(void);
+//call with worker threads idle, returns -1 if the file can't be written
+int  prof_write_chrome(const char *path);
+
+static inline struct prof_scope prof_scope_begin(const char *name)
+{
+    return (struct prof_scope){name, prof_now()};
+}
+
+static inline void prof_scope_end(struct prof_scope *s)
+{
+    prof_push(s->name, s->t0, prof_now());
+}
+
+static inline void prof_gpu_scope_end(int *zone)
+{
+    prof_gpu_end(*zone);
+}
+
+#define PROF_CAT_(a, b) a##b
+#define PROF_CAT(a, b) PROF_CAT_(a, b)
+#define PROF_ZONE(name) \
+    struct prof_scope PROF_CAT(prof_zone_, __LINE__) \
+    __attribute__((cleanup(prof_scope_end))) = prof_scope_begin(name)
+#define PROF_GPU_ZONE(name) \
+    int PROF_CAT(prof_gpu_zone_, __LINE__) \
+    __attribute__((cleanup(prof_gpu_scope_end))) = prof_gpu_begin(name)
+
+#else
+
+#define PROF_ZONE(name) do {} while (0)
+#define PROF_GPU_ZONE(name) do {} while (0)
+#define prof_init() ((void) 0)
+#define prof_thread_name(name) ((void) 0)
+#define prof_gpu_init(get_proc) (0) //nothing to disable
+#define prof_gpu_push(name, t0, t1) ((void) 0)
+#define prof_frame() ((void) 0)
+#define prof_write_chrome(path) (0)
+
+#endif
+
+#endif
@@ -0,0 +1,189 @@
+#include "common.h"
+#include "replay.h"
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static int read_event(struct replay *r)
+{
+    uint8_t b[20];
+    r->has_next = fread(b, 1, sizeof b, r->f) == sizeof b;
+    if (!r->has_next)
+        return -1;
+    r->next.frame = get_le32(b);
+    r->next.type  = get_le32(b + 4);
+    r->next.code  = get_le32(b + 8);
+    r->next.a     = get_le32(b + 12);
+    r->next.b     = get_le32(b + 16);
+    return 0;
+}
+
+static void write_event(struct replay *r, const struct replay_event *ev)
+{
+    uint8_t b[20];
+    put_le32(b, ev->frame);
+    put_le32(b + 4, ev->type);
+    put_le32(b + 8, ev->code);
+    put_le32(b + 12, ev->a);
+    put_le32(b + 16, ev->b);
+    fwrite(b, 1, sizeof b, r->f);
+}
+
+int replay_record(struct replay *r, const char *path, int w, int h, uint32_t seed, float dt)
+{
+    memset(r, 0, sizeof *r);
+    r->f = fopen(path, "wb");
+    if (!r->f){
+        r->last_error = "replay: cannot create file";
+        return -1;
+    }
+    uint8_t hdr[24];
+    uint32_t dt_bits;
+    memcpy(&dt_bits, &dt, sizeof dt_bits);
+    memcpy(hdr, "TRRP", 4);
+    put_le32(hdr + 4, REPLAY_VERSION);
+    put_le32(hdr + 8, w);
+    put_le32(hdr + 12, h);
+    put_le32(hdr + 16, seed);
+    put_le32(hdr + 20, dt_bits);
+    fwrite(hdr, 1, sizeof hdr, r->f);
+    r->mode = REPLAY_RECORD;
+    r->width = w;
+    r->height = h;
+    r->seed = seed;
+    r->dt = dt;
+    return 0;
+}
+
+int replay_open(struct replay *r, const char *path)
+{
+    memset(r, 0, sizeof *r);
+    r->f = fopen(path, "rb");
+    if (!r->f){
+        r->last_error = "replay: cannot open file";
+        return -1;
+    }
+    uint8_t hdr[24];
+    if (fread(hdr, 1, sizeof hdr, r->f) != sizeof hdr || memcmp(hdr, "TRRP", 4) != 0 ||
+        get_le32(hdr + 4) != REPLAY_VERSION)
+    {
+        r->last_error = "replay: not a replay file or wrong version";
+        fclose(r->f);
+        r->f = NULL;
+        return -1;
+    }
+    uint32_t dt_bits = get_le32(hdr + 20);
+    memcpy(&r->dt, &dt_bits, sizeof dt_bits);
+    r->width = get_le32(hdr + 8);
+    r->height = get_le32(hdr + 12);
+    r->seed = get_le32(hdr + 16);
+    r->mode = REPLAY_PLAY;
+    read_event(r);
+    return 0;
+}
+
+void replay_capture(struct replay *r, const SDL_Event *e)
+{
+    if (r->mode != REPLAY_RECORD)
+        return;
+    struct replay_event ev = {r->frame, e->type, 0, 0, 0};
+    switch (e->type){
+        case SDL_QUIT:
+        break;
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+            ev.code = e->key.keysym.sym;
+            ev.a = e->key.repeat;
+        break;
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+            ev.code = e->button.button;
+            ev.a = e->button.x;
+            ev.b = e->button.y;
+        break;
+        case SDL_MOUSEWHEEL:
+            ev.a = e->wheel.x;
+            ev.b = e->wheel.y;
+        break;
+        case SDL_WINDOWEVENT:
+            if (e->window.event != SDL_WINDOWEVENT_SIZE_CHANGED)
+                return;
+            ev.code = e->window.event;
+            ev.a = e->window.data1;
+            ev.b = e->window.data2;
+        break;
+        default:
+            return;
+    }
+    write_event(r, &ev);
+    r->events++;
+}
+
+int replay_poll(struct replay *r, SDL_Event *e)
+{
+    if (r->mode != REPLAY_PLAY || !r->has_next || r->next.frame > r->frame ||
+        r->next.type == REPLAY_END)
+        return 0;
+    struct replay_event *ev = &r->next;
+    memset(e, 0, sizeof *e);
+    e->type = ev->type;
+    switch (ev->type){
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+            e->key.state = ev->type == SDL_KEYDOWN ? SDL_PRESSED : SDL_RELEASED;
+            e->key.repeat = ev->a;
+            e->key.keysym.sym = ev->code;
+        break;
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+            e->button.state = ev->type == SDL_MOUSEBUTTONDOWN ? SDL_PRESSED : SDL_RELEASED;
+            e->button.button = ev->code;
+            e->button.x = ev->a;
+            e->button.y = ev->b;
+        break;
+        case SDL_MOUSEWHEEL:
+            e->wheel.x = ev->a;
+            e->wheel.y = ev->b;
+        break;
+        case SDL_WINDOWEVENT:
+            e->window.event = ev->code;
+            e->window.data1 = ev->a;
+            e->window.data2 = ev->b;
+        break;
+    }
+    r->events++;
+    read_event(r);
+    return 1;
+}
+
+void replay_next_frame(struct replay *r)
+{
+    r->frame++;
+}
+
+int replay_done(const struct replay *r)
+{
+    //files cut short end at their last event
+    return r->mode == REPLAY_PLAY &&
+           (!r->has_next || (r->next.type == REPLAY_END && r->next.frame <= r->frame));
+}
+
+void replay_close(struct replay *r)
+{
+    if (r->mode == REPLAY_RECORD)
+        write_event(r, &(struct replay_event){r->frame, REPLAY_END, 0, 0, 0});
+    if (r->f)
+        fclose(r->f);
+    r->f = NULL;
+    r->mode = REPLAY_OFF;
+}
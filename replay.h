@@ -0,0 +1,64 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <SDL.h>
+
+/*
+ * records the SDL events a demo reacts to, tagged with the frame they were
+ * handled in, and feeds them back at the same frames. both sides step the
+ * simulation with the fixed dt stored in the header, so a replay reproduces
+ * the recorded scene exactly and can be timed as a regression run.
+ *
+ * file: 24 byte header, then 20 byte records, all little endian u32
+ *   header: "TRRP" version width height seed dt(float bits)
+ *   record: frame type code a b
+ * the last record has type REPLAY_END and the number of frames recorded,
+ * playback runs to it rather than stopping at the last event.
+ */
+
+#define REPLAY_VERSION 2
+#define REPLAY_END     0 //SDL_FIRSTEVENT, never a real event
+
+enum replay_mode{
+    REPLAY_OFF,
+    REPLAY_RECORD,
+    REPLAY_PLAY,
+};
+
+struct replay_event{
+    uint32_t frame;
+    uint32_t type;  //SDL event type
+    int32_t code;   //key sym, mouse button or window event
+    int32_t a, b;   //x y, w h, wheel x y
+};
+
+struct replay{
+    enum replay_mode mode;
+    FILE *f;
+    uint32_t frame;
+    int width;      //window size at the start of the recording
+    int height;
+    uint32_t seed;
+    float dt;
+
+    struct replay_event next; //play: first event not yet injected
+    int has_next;
+    uint32_t events;
+    const char *last_error;
+};
+
+int  replay_record(struct replay *r, const char *path, int w, int h, uint32_t seed, float dt);
+int  replay_open(struct replay *r, const char *path);
+//record: call for every polled event, ignores what the demos do not handle
+void replay_capture(struct replay *r, const SDL_Event *e);
+//play: returns 1 and fills e while events remain for the current frame
+int  replay_poll(struct replay *r, SDL_Event *e);
+void replay_next_frame(struct replay *r);
+//play: the current frame is past the recording, or the file ran out
+int  replay_done(const struct replay *r);
+//record: ends the file with the frame count
+void replay_close(struct replay *r);
+
+#endif
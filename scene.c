@@ -0,0 +1,204 @@
+#include <fcntl.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "common.h"
+#include "glad/glad.h" //ui.h needs the GL types
+#include "ui.h"
+#include "scene.h"
+
+//bytes per triangle of every section but the ui
+static const size_t section_elem[SCENE_SECTIONS] = {
+    [SCENE_VERTICES]    = sizeof(struct vertex) * 3,
+    [SCENE_POS]         = sizeof(vec2),
+    [SCENE_VEL]         = sizeof(vec2),
+    [SCENE_ANGLE]       = sizeof(float),
+    [SCENE_ANGVEL]      = sizeof(float),
+    [SCENE_LOCAL]       = sizeof(vec2) * 3,
+    [SCENE_INV_MASS]    = sizeof(float),
+    [SCENE_INV_INERTIA] = sizeof(float),
+    [SCENE_STATE]       = sizeof(uint8_t),
+};
+
+static size_t align_up(size_t v)
+{
+    return (v + SCENE_ALIGN - 1) & ~(size_t) (SCENE_ALIGN - 1);
+}
+
+static int write_padded(FILE *f, const void *p, size_t n, size_t *at)
+{
+    static const char zero[SCENE_ALIGN];
+    if (n && fwrite(p, 1, n, f) != n)
+        return -1;
+    size_t pad = align_up(*at + n) - (*at + n);
+    if (pad && fwrite(zero, 1, pad, f) != pad)
+        return -1;
+    *at += n + pad;
+    return 0;
+}
+
+int scene_save(const struct phys_world *w, const struct ui *ui, const char *path)
+{
+    struct scene_header hdr = {{'T', 'S', 'C', 'N'}, SCENE_VERSION, sizeof hdr};
+    hdr.count = w->count;
+    hdr.floor_y = w->floor_y;
+    hdr.gravity = w->gravity;
+    hdr.cell_size = w->cell_size;
+
+    struct scene_ui *elems = calloc(ui->n_ui ? ui->n_ui : 1, sizeof *elems);
+    if (!elems)
+        return -1;
+    for (int i = 0; i < ui->n_ui; i++){
+        if (ui->ui_elems[i].head.type != UI_BUTTON)
+            continue;
+        const struct ui_button *b = (const struct ui_button *) &ui->ui_elems[i];
+        struct scene_ui *e = &elems[hdr.n_ui++];
+        e->type = UI_BUTTON;
+        e->x = b->rect.x;
+        e->y = b->rect.y;
+        e->w = b->rect.w;
+        e->h = b->rect.h;
+        memcpy(e->rgb, b->rect.rgb, 4);
+        memcpy(e->text_color, b->text_color, 4);
+        e->textlen = b->textlen < sizeof e->text - 1 ? b->textlen : sizeof e->text - 1;
+        memcpy(e->text, b->text, e->textlen);
+    }
+
+    const void *data[SCENE_SECTIONS] = {
+        [SCENE_VERTICES]    = w->vertices,
+        [SCENE_POS]         = w->pos,
+        [SCENE_VEL]         = w->vel,
+        [SCENE_ANGLE]       = w->angle,
+        [SCENE_ANGVEL]      = w->angvel,
+        [SCENE_LOCAL]       = w->local,
+        [SCENE_INV_MASS]    = w->inv_mass,
+        [SCENE_INV_INERTIA] = w->inv_inertia,
+        [SCENE_STATE]       = w->state,
+        [SCENE_UI]          = elems,
+    };
+    size_t at = align_up(sizeof hdr);
+    for (int i = 0; i < SCENE_SECTIONS; i++){
+        hdr.sections[i].offset = at;
+        hdr.sections[i].size = i == SCENE_UI ? sizeof *elems * hdr.n_ui : section_elem[i] * hdr.count;
+        at = align_up(at + hdr.sections[i].size);
+    }
+
+    FILE *f = fopen(path, "wb");
+    if (!f){
+        free(elems);
+        return -1;
+    }
+    at = 0;
+    int s = write_padded(f, &hdr, sizeof hdr, &at);
+    for (int i = 0; i < SCENE_SECTIONS && s == 0; i++)
+        s = write_padded(f, data[i], hdr.sections[i].size, &at);
+    free(elems);
+    if (fclose(f) != 0)
+        s = -1;
+    return s;
+}
+
+int scene_open(struct scene *s, const char *path)
+{
+    memset(s, 0, sizeof *s);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0){
+        s->last_error = "scene: cannot open file";
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(struct scene_header)){
+        close(fd);
+        s->last_error = "scene: file too small";
+        return -1;
+    }
+    s->size = st.st_size;
+    s->map = mmap(NULL, s->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (s->map == MAP_FAILED){
+        s->map = NULL;
+        s->last_error = "scene: mmap failed";
+        return -1;
+    }
+    madvise(s->map, s->size, MADV_WILLNEED);
+
+    const struct scene_header *hdr = s->map;
+    if (memcmp(hdr->magic, "TSCN", 4) != 0 || hdr->version != SCENE_VERSION ||
+        hdr->header_size != sizeof *hdr)
+    {
+        s->last_error = "scene: not a scene file or wrong version";
+        goto fail;
+    }
+    for (int i = 0; i < SCENE_SECTIONS; i++){
+        const struct scene_section *sec = &hdr->sections[i];
+        uint64_t want = i == SCENE_UI ? sizeof(struct scene_ui) * (uint64_t) hdr->n_ui
+                                      : section_elem[i] * (uint64_t) hdr->count;
+        if (sec->size != want || sec->offset % SCENE_ALIGN || sec->offset > s->size ||
+            sec->size > s->size - sec->offset)
+        {
+            s->last_error = "scene: bad section table";
+            goto fail;
+        }
+    }
+    //phys_set_cell_size() clamps small sizes, but not nan or infinity
+    if (!(hdr->cell_size > 0) || !isfinite(hdr->cell_size)){
+        s->last_error = "scene: bad cell size";
+        goto fail;
+    }
+    const struct scene_ui *ui = (const void *) ((const char *) s->map + hdr->sections[SCENE_UI].offset);
+    for (uint32_t i = 0; i < hdr->n_ui; i++){
+        if (ui[i].textlen > sizeof ui[i].text - 1){
+            s->last_error = "scene: ui text too long";
+            goto fail;
+        }
+    }
+    s->hdr = hdr;
+    s->vertices = (const void *) ((const char *) s->map + hdr->sections[SCENE_VERTICES].offset);
+    s->ui = ui;
+    return 0;
+fail:
+    munmap(s->map, s->size);
+    s->map = NULL;
+    return -1;
+}
+
+const void *scene_section(const struct scene *s, enum scene_section_id id)
+{
+    return (const char *) s->map + s->hdr->sections[id].offset;
+}
+
+int scene_load_world(const struct scene *s, struct phys_world *w)
+{
+    const struct scene_header *hdr = s->hdr;
+    if (hdr->count > (uint32_t) w->cap)
+        return -1;
+    //the old bodies go first, so resizing the grid has nothing to move
+    phys_clear(w);
+    phys_set_cell_size(w, hdr->cell_size);
+    void *dst[SCENE_SECTIONS] = {
+        [SCENE_VERTICES]    = w->vertices,
+        [SCENE_POS]         = w->pos,
+        [SCENE_VEL]         = w->vel,
+        [SCENE_ANGLE]       = w->angle,
+        [SCENE_ANGVEL]      = w->angvel,
+        [SCENE_LOCAL]       = w->local,
+        [SCENE_INV_MASS]    = w->inv_mass,
+        [SCENE_INV_INERTIA] = w->inv_inertia,
+        [SCENE_STATE]       = w->state,
+    };
+    for (int i = 0; i < SCENE_SECTIONS; i++){
+        if (dst[i])
+            memcpy(dst[i], (const char *) s->map + hdr->sections[i].offset, hdr->sections[i].size);
+    }
+    w->floor_y = hdr->floor_y;
+    w->gravity = hdr->gravity;
+    return phys_restore(w, hdr->count);
+}
+
+void scene_close(struct scene *s)
+{
+    if (s->map)
+        munmap(s->map, s->size);
+    memset(s, 0, sizeof *s);
+}
@@ -0,0 +1,81 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "phys.h"
+
+struct ui;
+
+/*
+ * binary scene files. a fixed header holds a table of sections, every
+ * section is a raw array in the in-memory layout of phys_world (or of the
+ * ui records below), 64 byte aligned. loading maps the file and copies the
+ * arrays straight into the world, the vertex section can go to GL as is.
+ * host byte order (little endian), the version is bumped on any change.
+ */
+
+#define SCENE_VERSION 1
+#define SCENE_ALIGN 64
+
+enum scene_section_id{
+    SCENE_VERTICES,    //struct vertex, 3 per triangle, positions and colours
+    SCENE_POS,         //vec2
+    SCENE_VEL,         //vec2
+    SCENE_ANGLE,       //float
+    SCENE_ANGVEL,      //float
+    SCENE_LOCAL,       //vec2, 3 per triangle
+    SCENE_INV_MASS,    //float
+    SCENE_INV_INERTIA, //float
+    SCENE_STATE,       //uint8_t, enum phys_body_state
+    SCENE_UI,          //struct scene_ui
+    SCENE_SECTIONS,
+};
+
+struct scene_section{
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct scene_header{
+    char magic[4];      //"TSCN"
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t count;     //triangles
+    uint32_t n_ui;
+    float floor_y;
+    float gravity;
+    float cell_size;
+    struct scene_section sections[SCENE_SECTIONS];
+};
+
+//a ui button, callbacks are code and get bound again by label
+struct scene_ui{
+    uint16_t type;
+    uint16_t x, y, w, h;
+    uint16_t textlen;
+    uint8_t rgb[4];
+    uint8_t text_color[4];
+    char text[44];
+};
+
+struct scene{
+    void *map;
+    size_t size;
+    const struct scene_header *hdr;
+    const struct vertex *vertices; //hdr->count * 3, points into the map
+    const struct scene_ui *ui;     //hdr->n_ui
+    const char *last_error;
+};
+
+//writes the world and the ui buttons
+int  scene_save(const struct phys_world *w, const struct ui *ui, const char *path);
+//maps and validates the file, nothing is copied
+int  scene_open(struct scene *s, const char *path);
+//start of a section inside the map
+const void *scene_section(const struct scene *s, enum scene_section_id id);
+//w->cap must hold hdr->count triangles
+int  scene_load_world(const struct scene *s, struct phys_world *w);
+void scene_close(struct scene *s);
+
+#endif
@@ -0,0 +1,199 @@
+#include <math.h>
+#include "common.h"
+#include "pfont.h"
+#include "sdf.h"
+
+#define FAR 1e20f
+
+struct edt_scratch{
+    float *f, *d, *z;
+    int *v;
+};
+
+//squared distance along one line to the nearest sample with f == 0, the
+//lower envelope of parabolas from Felzenszwalb and Huttenlocher
+static void edt_1d(const float *f, float *d, int n, int *v, float *z)
+{
+    int k = 0;
+    v[0] = 0;
+    z[0] = -FAR;
+    z[1] = FAR;
+    for (int q = 1; q < n; q++){
+        float s;
+        for (;;){
+            int r = v[k];
+            s = ((f[q] + q * q) - (f[r] + r * r)) / (2 * q - 2 * r);
+            if (s > z[k])
+                break;
+            k--; //stops at 0, z[0] is -FAR
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = FAR;
+    }
+    k = 0;
+    for (int q = 0; q < n; q++){
+        while (z[k + 1] < q)
+            k++;
+        d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+    }
+}
+
+//grid goes from 0 / FAR to squared distances, columns then rows
+static void edt(float *grid, int w, int h, struct edt_scratch *s)
+{
+    for (int x = 0; x < w; x++){
+        for (int y = 0; y < h; y++)
+            s->f[y] = grid[y * w + x];
+        edt_1d(s->f, s->d, h, s->v, s->z);
+        for (int y = 0; y < h; y++)
+            grid[y * w + x] = s->d[y];
+    }
+    for (int y = 0; y < h; y++){
+        edt_1d(grid + y * w, s->d, w, s->v, s->z);
+        memcpy(grid + y * w, s->d, sizeof *s->d * w);
+    }
+}
+
+static int glyph_bit(const struct pfont *f, const struct pfont_glyph *g, int x, int y)
+{
+    const uint8_t *bits = f->bits + g->bits + y * ((g->w + 7) / 8);
+    return bits[x / 8] >> (7 - x % 8) & 1U;
+}
+
+static int blank(const struct pfont *f, const struct pfont_glyph *g)
+{
+    for (int y = 0; y < g->h; y++)
+        for (int x = 0; x < g->w; x++)
+            if (glyph_bit(f, g, x, y))
+                return 0;
+    return 1;
+}
+
+//texel (tx, ty) of the glyph's cell is inside its bitmap
+static int inside(const struct pfont *f, const struct pfont_glyph *g, int tx, int ty)
+{
+    if (tx < SDF_PAD || ty < SDF_PAD)
+        return 0;
+    int x = (tx - SDF_PAD) / SDF_SCALE, y = (ty - SDF_PAD) / SDF_SCALE;
+    return x < g->w && y < g->h && glyph_bit(f, g, x, y);
+}
+
+static void render_cell(struct sdf_atlas *a, int glyph, float *out, float *in, struct edt_scratch *s)
+{
+    const struct pfont_glyph *g = &a->font->glyphs[glyph];
+    const struct sdf_cell *c = &a->cells[glyph];
+    for (int ty = 0; ty < c->h; ty++)
+        for (int tx = 0; tx < c->w; tx++){
+            int i = ty * c->w + tx, set = inside(a->font, g, tx, ty);
+            out[i] = set ? 0 : FAR;
+            in[i] = set ? FAR : 0;
+        }
+    edt(out, c->w, c->h, s);
+    edt(in, c->w, c->h, s);
+    //distances between texel centres, half a texel to the edge between them
+    for (int ty = 0; ty < c->h; ty++)
+        for (int tx = 0; tx < c->w; tx++){
+            int i = ty * c->w + tx;
+            float d = in[i] > 0 ? sqrtf(in[i]) - 0.5f : 0.5f - sqrtf(out[i]);
+            float v = 128.0f + d * 127.0f / SDF_PAD;
+            a->texels[(c->y + ty) * a->w + c->x + tx] = v < 0 ? 0 : v > 255 ? 255 : v;
+        }
+}
+
+//rows of cells left to right, a row as high as its tallest cell
+static int pack(struct sdf_atlas *a, int n)
+{
+    uint64_t area = 0;
+    int widest = 0;
+    for (int i = 0; i < n; i++){
+        area += a->cells[i].w * a->cells[i].h;
+        if (a->cells[i].w > widest)
+            widest = a->cells[i].w;
+    }
+    a->w = 64;
+    while (a->w < SDF_MAX_DIM && ((uint64_t) a->w * a->w < area || a->w < widest))
+        a->w *= 2;
+    int x = 0, y = 0, row = 0;
+    for (int i = 0; i < n; i++){
+        struct sdf_cell *c = &a->cells[i];
+        if (!c->w)
+            continue;
+        if (x + c->w > a->w){
+            x = 0;
+            y += row;
+            row = 0;
+        }
+        c->x = x;
+        c->y = y;
+        x += c->w;
+        if (c->h > row)
+            row = c->h;
+    }
+    a->h = y + row;
+    if (widest > a->w || a->h > SDF_MAX_DIM){
+        a->last_error = "sdf: atlas too big";
+        return -1;
+    }
+    return 0;
+}
+
+int sdf_build(struct sdf_atlas *a, const struct pfont *f)
+{
+    memset(a, 0, sizeof *a);
+    a->font = f;
+    int n = f->hdr->n_glyphs;
+    a->cells = calloc(n, sizeof *a->cells);
+    if (!a->cells)
+        goto oom;
+    int cell_max = 1, side_max = 1;
+    for (int i = 0; i < n; i++){
+        const struct pfont_glyph *g = &f->glyphs[i];
+        if (blank(f, g))
+            continue;
+        a->cells[i].w = g->w * SDF_SCALE + 2 * SDF_PAD;
+        a->cells[i].h = g->h * SDF_SCALE + 2 * SDF_PAD;
+        if (a->cells[i].w * a->cells[i].h > cell_max)
+            cell_max = a->cells[i].w * a->cells[i].h;
+        if (a->cells[i].w > side_max)
+            side_max = a->cells[i].w;
+        if (a->cells[i].h > side_max)
+            side_max = a->cells[i].h;
+    }
+    if (pack(a, n) < 0){
+        sdf_free(a);
+        return -1;
+    }
+    a->texels = calloc((size_t) a->w * a->h, 1);
+    float *out = malloc(sizeof *out * cell_max), *in = malloc(sizeof *in * cell_max);
+    struct edt_scratch s = {
+        malloc(sizeof *s.f * side_max), malloc(sizeof *s.d * side_max),
+        malloc(sizeof *s.z * (side_max + 1)), malloc(sizeof *s.v * side_max),
+    };
+    int ok = a->texels && out && in && s.f && s.d && s.z && s.v;
+    for (int i = 0; ok && i < n; i++)
+        if (a->cells[i].w)
+            render_cell(a, i, out, in, &s);
+    free(out);
+    free(in);
+    free(s.f);
+    free(s.d);
+    free(s.z);
+    free(s.v);
+    if (ok)
+        return 0;
+oom:
+    sdf_free(a);
+    a->last_error = "sdf: out of memory";
+    return -1;
+}
+
+void sdf_free(struct sdf_atlas *a)
+{
+    free(a->texels);
+    free(a->cells);
+    a->texels = NULL;
+    a->cells = NULL;
+    a->w = a->h = 0;
+}
@@ -0,0 +1,38 @@
+#ifndef SDF_H
+#define SDF_H
+
+#include <stdint.h>
+
+struct pfont;
+
+/*
+ * a signed distance field atlas of a pfont, built on the cpu from the
+ * glyph bitmaps. every font pixel becomes SDF_SCALE texels and the field
+ * reaches SDF_PAD texels past the edges, so a shader thresholding the
+ * bilinear sample at 0.5 gets the bitmap's outline back, sharp at any
+ * magnification. one cell per glyph, packed in shelves.
+ */
+
+#define SDF_SCALE   4    //texels per font pixel
+#define SDF_PAD     4    //texels of field around a glyph, what 0..255 spans on each side
+#define SDF_MAX_DIM 4096 //atlas width and height, what any GL 3 driver takes
+
+//texels of a glyph, padding included. w == 0 for blank glyphs
+struct sdf_cell{
+    uint16_t x, y, w, h;
+};
+
+struct sdf_atlas{
+    const struct pfont *font;
+    int w, h;
+    uint8_t *texels;        //w * h, 128 on the edge, above it inside
+    struct sdf_cell *cells; //font->hdr->n_glyphs
+    const char *last_error;
+};
+
+//every glyph of f. -1 and last_error when out of memory or the atlas would
+//pass SDF_MAX_DIM, with nothing left allocated
+int  sdf_build(struct sdf_atlas *a, const struct pfont *f);
+void sdf_free(struct sdf_atlas *a);
+
+#endif
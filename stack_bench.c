@@ -0,0 +1,78 @@
+#include "common.h"
+#include <SDL.h>
+#include "phys.h"
+
+/*
+ * headless stacking scene for the broadphase.
+ * usage: ./stack_bench [triangles] [steps]
+ * prints one tab separated line per step, then the averages.
+ */
+
+#define COLUMNS 2000
+
+static uint64_t freq;
+
+static double ms_since(uint64_t t0)
+{
+    return (SDL_GetPerformanceCounter() - t0) * 1000.0 / freq;
+}
+
+static void build_scene(struct phys_world *w, int n)
+{
+    float pitch = 2.0f / COLUMNS;
+    float size = pitch * 0.8f;
+    phys_set_cell_size(w, size * 2.0f);
+    for (int i = 0; i < n; i++){
+        int col = i % COLUMNS, row = i / COLUMNS;
+        float jitter = ((rand() % 1000) / 1000.0f - 0.5f) * 0.6f * size;
+        float x = -1.0f + col * pitch + jitter;
+        float y = w->floor_y + row * size * 1.05f;
+        uint8_t rgb[3] = { (uint8_t) rand(), (uint8_t) rand(), (uint8_t) rand() };
+        phys_add_triangle(w, (vec2){x, y}, (vec2){x + size, y}, (vec2){x + size / 2.0f, y + size}, rgb);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int n = argc > 1 ? atoi(argv[1]) : 100000;
+    int steps = argc > 2 ? atoi(argv[2]) : 120;
+    const float dt = 1.0f / 60;
+    struct phys_world w;
+
+    freq = SDL_GetPerformanceFrequency();
+    srand(0xBADBEEF0);
+    if (n < 1 || steps < 1)
+        die("usage: %s [triangles] [steps]", argv[0]);
+    if (phys_init(&w, n) < 0)
+        die("phys_init: out of memory");
+    build_scene(&w, n);
+
+    double sum_broad = 0.0, sum_narrow = 0.0, sum_solve = 0.0;
+    long sum_pairs = 0;
+    printf("step\tawake\tpairs\tcontacts\tbroad_ms\tnarrow_ms\tsolve_ms\tstep_ms\n");
+    for (int s = 0; s < steps; s++){
+        uint64_t t0 = SDL_GetPerformanceCounter();
+        if (phys_broadphase(&w) < 0)
+            die("broadphase: out of memory");
+        double t_broad = ms_since(t0);
+
+        uint64_t t1 = SDL_GetPerformanceCounter();
+        phys_narrowphase(&w);
+        double t_narrow = ms_since(t1);
+
+        uint64_t t2 = SDL_GetPerformanceCounter();
+        phys_solve(&w, dt);
+        double t_solve = ms_since(t2);
+
+        printf("%d\t%d\t%d\t%d\t%.3f\t%.3f\t%.3f\t%.3f\n", s, w.n_awake, w.stats.pairs,
+               w.stats.contacts, t_broad, t_narrow, t_solve, ms_since(t0));
+        sum_broad += t_broad;
+        sum_narrow += t_narrow;
+        sum_solve += t_solve;
+        sum_pairs += w.stats.pairs;
+    }
+    fprintf(stderr, "%d triangles, %d steps: avg pairs %ld, broad %.3fms, narrow %.3fms, solve %.3fms\n",
+            n, steps, sum_pairs / steps, sum_broad / steps, sum_narrow / steps, sum_solve / steps);
+    phys_free(&w);
+    return 0;
+}
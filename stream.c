@@ -0,0 +1,494 @@
+#include <math.h>
+#include <unistd.h>
+#include "common.h"
+#include "stream.h"
+#include "prof.h"
+
+#define RING (STREAM_STAGING + 1)
+
+static int grow(void **arr, int *cap, int need, size_t elem)
+{
+    if (need <= *cap)
+        return 0;
+    int ncap = *cap ? *cap : 64;
+    while (ncap < need)
+        ncap *= 2;
+    void *p = realloc(*arr, elem * ncap);
+    if (!p)
+        return -1;
+    *arr = p;
+    *cap = ncap;
+    return 0;
+}
+
+static unsigned hash_cell(int cx, int cy, int cap)
+{
+    return ((unsigned) cx * 73856093u ^ (unsigned) cy * 19349663u) & (cap - 1);
+}
+
+static int rehash(struct stream *s, int cap)
+{
+    int *h = malloc(sizeof(int) * cap);
+    if (!h)
+        return -1;
+    memset(h, 0xFF, sizeof(int) * cap);
+    for (int i = 0; i < s->n_chunks; i++){
+        unsigned k = hash_cell(s->chunks[i].cx, s->chunks[i].cy, cap);
+        while (h[k] >= 0)
+            k = (k + 1) & (cap - 1);
+        h[k] = i;
+    }
+    free(s->hash);
+    s->hash = h;
+    s->hash_cap = cap;
+    return 0;
+}
+
+static int chunk_get(struct stream *s, int cx, int cy, int create)
+{
+    unsigned k = hash_cell(cx, cy, s->hash_cap);
+    for (; s->hash[k] >= 0; k = (k + 1) & (s->hash_cap - 1)){
+        struct stream_chunk *c = &s->chunks[s->hash[k]];
+        if (c->cx == cx && c->cy == cy)
+            return s->hash[k];
+    }
+    if (!create)
+        return -1;
+    if ((s->n_chunks + 1) * 2 > s->hash_cap){
+        if (rehash(s, s->hash_cap * 2) < 0)
+            return -1;
+        return chunk_get(s, cx, cy, create);
+    }
+    if (grow((void **) &s->chunks, &s->chunks_cap, s->n_chunks + 1, sizeof(struct stream_chunk)) < 0)
+        return -1;
+    int i = s->n_chunks++;
+    s->chunks[i] = (struct stream_chunk){cx, cy, -1, 0};
+    s->hash[k] = i;
+    return i;
+}
+
+static int cell_of(struct stream *s, float v)
+{
+    return (int) floorf(v / s->chunk_size);
+}
+
+_Static_assert(1 << (STREAM_CLASSES - 1) == STREAM_SEGMENT, "the largest extent holds a segment");
+
+static int ext_class(int count)
+{
+    int c = 0;
+    while (1 << c < count)
+        c++;
+    return c;
+}
+
+static uint64_t ext_alloc(struct stream *s, int count)
+{
+    int c = ext_class(count);
+    if (s->n_ext_free[c])
+        return s->ext_free[c][--s->n_ext_free[c]];
+    uint64_t at = s->store_end;
+    s->store_end += sizeof(struct phys_body) << c;
+    return at;
+}
+
+//only once nothing queued for the io thread touches the extent
+static void ext_release(struct stream *s, uint64_t offset, int count)
+{
+    int c = ext_class(count);
+    //out of memory leaks the extent, the file just grows
+    if (grow((void **) &s->ext_free[c], &s->ext_free_cap[c], s->n_ext_free[c] + 1, sizeof(uint64_t)) == 0)
+        s->ext_free[c][s->n_ext_free[c]++] = offset;
+}
+
+static int seg_alloc(struct stream *s, int chunk, int count)
+{
+    if (s->seg_free < 0){
+        int old = s->segs_cap;
+        if (grow((void **) &s->segs, &s->segs_cap, old + 1, sizeof(struct stream_segment)) < 0)
+            return -1;
+        for (int i = s->segs_cap - 1; i >= old; i--){
+            s->segs[i].next = s->seg_free;
+            s->seg_free = i;
+        }
+    }
+    int g = s->seg_free;
+    struct stream_segment *seg = &s->segs[g];
+    s->seg_free = seg->next;
+    seg->chunk = chunk;
+    seg->count = count;
+    seg->buf = -1;
+    seg->offset = ext_alloc(s, count);
+    seg->next = s->chunks[chunk].first_seg;
+    s->chunks[chunk].first_seg = g;
+    return g;
+}
+
+static void seg_release(struct stream *s, int g)
+{
+    struct stream_segment *seg = &s->segs[g];
+    int *link = &s->chunks[seg->chunk].first_seg;
+    while (*link != g)
+        link = &s->segs[*link].next;
+    *link = seg->next;
+    seg->next = s->seg_free;
+    s->seg_free = g;
+    ext_release(s, seg->offset, seg->count);
+}
+
+static int io_thread(void *arg)
+{
+    struct stream *s = arg;
+    prof_thread_name("stream");
+    for (;;){
+        SDL_SemWait(s->wake);
+        SDL_LockMutex(s->lock);
+        if (s->req_head == s->req_tail){
+            int quit = s->quit;
+            SDL_UnlockMutex(s->lock);
+            if (quit)
+                break;
+            continue;
+        }
+        struct stream_req r = s->req[s->req_tail];
+        s->req_tail = (s->req_tail + 1) % RING;
+        SDL_UnlockMutex(s->lock);
+
+        PROF_ZONE(r.write ? "page_out" : "page_in");
+        size_t n = sizeof(struct phys_body) * r.count;
+        ssize_t got = r.write ? pwrite(s->fd, s->staging[r.buf], n, r.offset)
+                              : pread(s->fd, s->staging[r.buf], n, r.offset);
+
+        SDL_LockMutex(s->lock);
+        if (got != (ssize_t) n)
+            s->io_error = 1;
+        s->done[s->done_head] = r.seg;
+        s->done_head = (s->done_head + 1) % RING;
+        SDL_UnlockMutex(s->lock);
+    }
+    return 0;
+}
+
+static void submit(struct stream *s, int g, int write)
+{
+    struct stream_segment *seg = &s->segs[g];
+    SDL_LockMutex(s->lock);
+    s->req[s->req_head] = (struct stream_req){write, g, seg->buf, seg->count, seg->offset};
+    s->req_head = (s->req_head + 1) % RING;
+    SDL_UnlockMutex(s->lock);
+    SDL_SemPost(s->wake);
+    s->stats.pending++;
+}
+
+int stream_init(struct stream *s, struct phys_world *w, float chunk_size)
+{
+    memset(s, 0, sizeof *s);
+    s->w = w;
+    s->chunk_size = chunk_size > 0.0f ? chunk_size : 0.5f;
+    s->evict_interval = 60;
+    s->high_water = 0.75f;
+    s->seg_free = -1;
+    s->store = tmpfile();
+    if (!s->store){
+        s->last_error = "stream: cannot create the backing file";
+        return -1;
+    }
+    s->fd = fileno(s->store);
+    if (rehash(s, 256) < 0)
+        goto fail;
+    for (int i = 0; i < STREAM_STAGING; i++){
+        s->staging[i] = malloc(sizeof(struct phys_body) * STREAM_SEGMENT);
+        if (!s->staging[i])
+            goto fail;
+        s->buf_free[s->n_buf_free++] = i;
+    }
+    s->lock = SDL_CreateMutex();
+    s->wake = SDL_CreateSemaphore(0);
+    if (!s->lock || !s->wake)
+        goto fail;
+    s->thread = SDL_CreateThread(io_thread, "stream", s);
+    if (!s->thread)
+        goto fail;
+    return 0;
+fail:
+    if (!s->last_error)
+        s->last_error = "stream: out of memory";
+    stream_free(s);
+    return -1;
+}
+
+void stream_free(struct stream *s)
+{
+    if (s->thread){
+        SDL_LockMutex(s->lock);
+        s->quit = 1;
+        SDL_UnlockMutex(s->lock);
+        SDL_SemPost(s->wake);
+        SDL_WaitThread(s->thread, NULL);
+    }
+    if (s->lock)
+        SDL_DestroyMutex(s->lock);
+    if (s->wake)
+        SDL_DestroySemaphore(s->wake);
+    for (int i = 0; i < STREAM_STAGING; i++)
+        free(s->staging[i]);
+    if (s->store)
+        fclose(s->store);
+    free(s->chunks);
+    free(s->hash);
+    free(s->segs);
+    free(s->cand);
+    for (int c = 0; c < STREAM_CLASSES; c++)
+        free(s->ext_free[c]);
+    memset(s, 0, sizeof *s);
+}
+
+//import side, synchronous: nothing else uses the file yet
+static int flush_import(struct stream *s, int chunk, const struct phys_body *b, int n)
+{
+    int g = seg_alloc(s, chunk, n);
+    if (g < 0)
+        return -1;
+    size_t len = sizeof(struct phys_body) * n;
+    if (pwrite(s->fd, b, len, s->segs[g].offset) != (ssize_t) len)
+        return -1;
+    s->segs[g].state = STREAM_PAGED;
+    s->stats.paged += n;
+    return 0;
+}
+
+int stream_import(struct stream *s, const struct scene *sc)
+{
+    const struct scene_header *hdr = sc->hdr;
+    const vec2 *pos = (const vec2 *) scene_section(sc, SCENE_POS);
+    const vec2 *vel = (const vec2 *) scene_section(sc, SCENE_VEL);
+    const float *angle = scene_section(sc, SCENE_ANGLE);
+    const float *angvel = scene_section(sc, SCENE_ANGVEL);
+    const vec2 *local = (const vec2 *) scene_section(sc, SCENE_LOCAL);
+    const float *inv_mass = scene_section(sc, SCENE_INV_MASS);
+    const float *inv_inertia = scene_section(sc, SCENE_INV_INERTIA);
+    const uint8_t *state = scene_section(sc, SCENE_STATE);
+
+    //one small buffer per touched chunk, written out as a segment when full
+    struct phys_body **pend = NULL;
+    int *pend_n = NULL;
+    int pend_cap = 0, pend_n_cap = 0;
+    int status = 0;
+
+    for (uint32_t i = 0; i < hdr->count; i++){
+        int c = chunk_get(s, cell_of(s, pos[i][0]), cell_of(s, pos[i][1]), 1);
+        if (c < 0){
+            status = -1;
+            break;
+        }
+        if (c >= pend_cap){
+            int old = pend_cap;
+            if (grow((void **) &pend, &pend_cap, c + 1, sizeof *pend) < 0 ||
+                grow((void **) &pend_n, &pend_n_cap, pend_cap, sizeof *pend_n) < 0)
+            {
+                status = -1;
+                break;
+            }
+            for (int k = old; k < pend_cap; k++){
+                pend[k] = NULL;
+                pend_n[k] = 0;
+            }
+        }
+        if (!pend[c] && !(pend[c] = malloc(sizeof(struct phys_body) * STREAM_IMPORT))){
+            status = -1;
+            break;
+        }
+        struct phys_body *b = &pend[c][pend_n[c]++];
+        memcpy(b->v, sc->vertices + i * 3, sizeof b->v);
+        memcpy(b->pos, pos[i], sizeof(vec2));
+        memcpy(b->vel, vel[i], sizeof(vec2));
+        b->angle = angle[i];
+        b->angvel = angvel[i];
+        memcpy(b->local, local + i * 3, sizeof b->local);
+        b->inv_mass = inv_mass[i];
+        b->inv_inertia = inv_inertia[i];
+        b->state = state[i];
+        if (pend_n[c] == STREAM_IMPORT){
+            status = flush_import(s, c, pend[c], pend_n[c]);
+            pend_n[c] = 0;
+        }
+    }
+    for (int k = 0; k < pend_cap; k++){
+        if (status == 0 && pend_n[k])
+            status = flush_import(s, k, pend[k], pend_n[k]);
+        free(pend[k]);
+    }
+    free(pend);
+    free(pend_n);
+    if (status < 0)
+        s->last_error = "stream: import failed";
+    return status;
+}
+
+static void collect(struct stream *s)
+{
+    int done[RING], n = 0;
+    SDL_LockMutex(s->lock);
+    while (s->done_tail != s->done_head){
+        done[n++] = s->done[s->done_tail];
+        s->done_tail = (s->done_tail + 1) % RING;
+    }
+    if (s->io_error && !s->last_error)
+        s->last_error = "stream: i/o error on the backing file";
+    SDL_UnlockMutex(s->lock);
+
+    for (int k = 0; k < n; k++){
+        struct stream_segment *seg = &s->segs[done[k]];
+        s->stats.pending--;
+        if (seg->state == STREAM_WRITING){
+            s->buf_free[s->n_buf_free++] = seg->buf;
+            seg->buf = -1;
+            seg->state = STREAM_PAGED;
+        }
+        else {
+            seg->state = STREAM_LOADED;
+            s->loaded[s->n_loaded++] = done[k];
+        }
+    }
+
+    //into the world while there is room, oldest first
+    int kept = 0;
+    for (int k = 0; k < s->n_loaded; k++){
+        int g = s->loaded[k];
+        struct stream_segment *seg = &s->segs[g];
+        if (s->w->count + seg->count > s->w->cap){
+            s->loaded[kept++] = g;
+            continue;
+        }
+        for (int j = 0; j < seg->count; j++)
+            phys_add_body(s->w, &s->staging[seg->buf][j]);
+        s->stats.paged -= seg->count;
+        s->stats.loaded += seg->count;
+        s->buf_free[s->n_buf_free++] = seg->buf;
+        seg_release(s, g);
+    }
+    s->n_loaded = kept;
+}
+
+static int overlaps_view(struct stream *s, int cx, int cy, const struct aabb *view)
+{
+    //one chunk of margin, bodies stick out of the chunk their centre is in
+    float x0 = (cx - 1) * s->chunk_size, x1 = (cx + 2) * s->chunk_size;
+    float y0 = (cy - 1) * s->chunk_size, y1 = (cy + 2) * s->chunk_size;
+    return x0 <= view->maxx && x1 >= view->minx && y0 <= view->maxy && y1 >= view->miny;
+}
+
+//chunks within reach of awake bodies, created when an eviction pass needs them
+static void mark_hot(struct stream *s, int create)
+{
+    struct phys_world *w = s->w;
+    for (int k = 0; k < w->n_awake; k++){
+        struct aabb *b = &w->boxes[w->awake[k]];
+        int x0 = cell_of(s, b->minx) - 1, x1 = cell_of(s, b->maxx) + 1;
+        int y0 = cell_of(s, b->miny) - 1, y1 = cell_of(s, b->maxy) + 1;
+        for (int y = y0; y <= y1; y++){
+            for (int x = x0; x <= x1; x++){
+                int c = chunk_get(s, x, y, create);
+                if (c >= 0)
+                    s->chunks[c].hot = s->frame;
+            }
+        }
+    }
+}
+
+static int cmp_cand(const void *a, const void *b)
+{
+    const int *x = a, *y = b;
+    if (x[0] != y[0])
+        return x[0] < y[0] ? -1 : 1;
+    return (x[1] > y[1]) - (x[1] < y[1]);
+}
+
+static int cmp_desc(const void *a, const void *b)
+{
+    int x = *(const int *) a, y = *(const int *) b;
+    return (x < y) - (x > y);
+}
+
+static void evict(struct stream *s, const struct aabb *view)
+{
+    struct phys_world *w = s->w;
+    int room = s->n_buf_free * STREAM_SEGMENT;
+    int n = 0;
+    for (int i = 0; i < w->count && n < room; i++){
+        if (w->state[i] != PHYS_SLEEPING)
+            continue;
+        int cx = cell_of(s, w->pos[i][0]), cy = cell_of(s, w->pos[i][1]);
+        if (overlaps_view(s, cx, cy, view))
+            continue;
+        int c = chunk_get(s, cx, cy, 1);
+        if (c < 0 || s->chunks[c].hot == s->frame)
+            continue;
+        if (grow((void **) &s->cand, &s->cand_cap, 2 * (n + 1), sizeof(int)) < 0)
+            break;
+        s->cand[2 * n] = c;
+        s->cand[2 * n + 1] = i;
+        n++;
+    }
+    if (!n)
+        return;
+    qsort(s->cand, n, sizeof(int) * 2, cmp_cand);
+
+    //pack runs of the same chunk into staging buffers
+    int written = 0;
+    for (int k = 0; k < n && s->n_buf_free; ){
+        int c = s->cand[2 * k];
+        int len = 0;
+        while (k + len < n && len < STREAM_SEGMENT && s->cand[2 * (k + len)] == c)
+            len++;
+        int g = seg_alloc(s, c, len);
+        if (g < 0)
+            break;
+        struct stream_segment *seg = &s->segs[g];
+        seg->buf = s->buf_free[--s->n_buf_free];
+        seg->state = STREAM_WRITING;
+        for (int j = 0; j < len; j++){
+            phys_get_body(w, s->cand[2 * (k + j) + 1], &s->staging[seg->buf][j]);
+            //reuse the pair's first slot for the removal list
+            s->cand[written++] = s->cand[2 * (k + j) + 1];
+        }
+        submit(s, g, 1);
+        s->stats.paged += len;
+        s->stats.evicted += len;
+        k += len;
+    }
+    //highest index first so the bodies swapped into holes are never evicted ones
+    qsort(s->cand, written, sizeof(int), cmp_desc);
+    for (int k = 0; k < written; k++)
+        phys_remove(w, s->cand[k]);
+}
+
+void stream_update(struct stream *s, const struct aabb *view)
+{
+    struct phys_world *w = s->w;
+    s->frame++;
+    collect(s);
+
+    int evict_now = s->frame % s->evict_interval == 0 || w->count > w->cap * s->high_water;
+    if (s->stats.paged > 0 || evict_now)
+        mark_hot(s, evict_now);
+
+    //read back whatever is wanted again, as far as the staging pool allows
+    if (s->stats.paged > 0){
+        for (int c = 0; c < s->n_chunks && s->n_buf_free; c++){
+            struct stream_chunk *ch = &s->chunks[c];
+            if (ch->first_seg < 0 || (ch->hot != s->frame && !overlaps_view(s, ch->cx, ch->cy, view)))
+                continue;
+            for (int g = ch->first_seg; g >= 0 && s->n_buf_free; g = s->segs[g].next){
+                struct stream_segment *seg = &s->segs[g];
+                if (seg->state != STREAM_PAGED)
+                    continue;
+                seg->buf = s->buf_free[--s->n_buf_free];
+                seg->state = STREAM_LOADING;
+                submit(s, g, 0);
+            }
+        }
+    }
+    if (evict_now)
+        evict(s, view);
+}
@@ -0,0 +1,120 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <SDL.h>
+#include "phys.h"
+#include "scene.h"
+
+/*
+ * keeps only the part of a large world that matters in the phys_world.
+ * space is cut into square chunks. sleeping triangles in chunks that are
+ * out of view and away from anything awake are written to a backing file
+ * and removed from the world, chunks that come into view or get near an
+ * awake body are read back. all file i/o runs on one background thread and
+ * goes through a fixed pool of staging buffers, so memory and requests in
+ * flight stay bounded and the main thread never waits on the disk.
+ *
+ * the backing file is an unlinked temporary. segments take extents of a
+ * power of 2 bodies, extents of segments that were read back go on a free
+ * list per size and are reused, so the file stays as big as the most that
+ * was ever paged out at once, give or take the rounding.
+ */
+
+#define STREAM_SEGMENT 512   //bodies per staging buffer and disk segment
+#define STREAM_CLASSES 10    //extent sizes, 1 to STREAM_SEGMENT bodies
+#define STREAM_STAGING 16    //staging buffers
+#define STREAM_IMPORT  128   //bodies buffered per chunk while importing
+
+enum stream_seg_state{
+    STREAM_WRITING, //in a staging buffer, queued for the disk
+    STREAM_PAGED,   //on disk only
+    STREAM_LOADING, //read queued
+    STREAM_LOADED,  //in a staging buffer, waiting for room in the world
+};
+
+struct stream_segment{
+    int chunk;
+    int next;       //next segment of the chunk, or of the free list
+    int count;
+    int buf;        //staging buffer while writing/loading/loaded
+    uint64_t offset;
+    enum stream_seg_state state;
+};
+
+struct stream_chunk{
+    int cx, cy;
+    int first_seg;  //-1 when nothing is paged out
+    uint32_t hot;   //frame an awake body was last near it
+};
+
+//a copy of what the io thread needs, it never looks at segs
+struct stream_req{
+    int write;
+    int seg;
+    int buf;
+    int count;
+    uint64_t offset;
+};
+
+struct stream{
+    struct phys_world *w;
+    float chunk_size;
+    int evict_interval; //frames between eviction passes
+    float high_water;   //fraction of w->cap that forces one
+
+    FILE *store;
+    int fd;
+    uint64_t store_end;
+    uint64_t *ext_free[STREAM_CLASSES]; //offsets of released extents
+    int n_ext_free[STREAM_CLASSES], ext_free_cap[STREAM_CLASSES];
+
+    struct stream_chunk *chunks;
+    int n_chunks, chunks_cap;
+    int *hash;          //chunk index or -1, power of 2
+    int hash_cap;
+
+    struct stream_segment *segs;
+    int segs_cap;
+    int seg_free;
+
+    struct phys_body *staging[STREAM_STAGING];
+    int buf_free[STREAM_STAGING];
+    int n_buf_free;
+    int loaded[STREAM_STAGING]; //segments waiting to enter the world
+    int n_loaded;
+
+    //main -> io and io -> main, each slot owns a staging buffer so neither overflows
+    struct stream_req req[STREAM_STAGING + 1];
+    int req_head, req_tail;
+    int done[STREAM_STAGING + 1];
+    int done_head, done_tail;
+    SDL_mutex *lock;
+    SDL_sem *wake;
+    SDL_Thread *thread;
+    int quit;
+    int io_error;
+
+    uint32_t frame;
+    int *cand;          //eviction scratch
+    int cand_cap;
+
+    struct {
+        int paged;      //bodies on disk
+        int pending;    //segments queued or staged
+        uint64_t evicted;
+        uint64_t loaded;
+    } stats;
+    const char *last_error;
+};
+
+int  stream_init(struct stream *s, struct phys_world *w, float chunk_size);
+void stream_free(struct stream *s);
+//pages a whole scene file out to the backing store, nothing enters the
+//world until stream_update() finds it in view
+int  stream_import(struct stream *s, const struct scene *sc);
+//once per frame between steps, view is the visible world rectangle
+void stream_update(struct stream *s, const struct aabb *view);
+
+#endif
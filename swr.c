@@ -0,0 +1,370 @@
+#include "common.h"
+#include "swr.h"
+#include "prof.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define SUBPIXEL 16.0f
+
+static int grow(void **arr, int *cap, int need, size_t elem)
+{
+    if (need <= *cap)
+        return 0;
+    int ncap = *cap ? *cap : 256;
+    while (ncap < need)
+        ncap *= 2;
+    void *p = realloc(*arr, elem * ncap);
+    if (!p)
+        return -1;
+    *arr = p;
+    *cap = ncap;
+    return 0;
+}
+
+static void raster_tile(struct swr *r, int t);
+
+static int worker(void *arg)
+{
+    struct swr *r = arg;
+    prof_thread_name("swr");
+    for (;;){
+        SDL_SemWait(r->start);
+        if (r->quit)
+            break;
+        PROF_ZONE("swr_tiles");
+        int t;
+        while ((t = SDL_AtomicAdd(&r->next_tile, 1)) < r->tiles_x * r->tiles_y)
+            raster_tile(r, t);
+        SDL_SemPost(r->done);
+    }
+    return 0;
+}
+
+static void free_tiles(struct swr *r)
+{
+    for (int i = 0; i < r->tiles_x * r->tiles_y; i++)
+        free(r->tiles[i].prims);
+    free(r->tiles);
+    r->tiles = NULL;
+    r->tiles_x = r->tiles_y = 0;
+}
+
+int swr_resize(struct swr *r, int w, int h)
+{
+    if (w < 1 || h < 1)
+        return -1;
+    if (w == r->width && h == r->height)
+        return 0;
+    int stride = (w + 3) & ~3;
+    uint32_t *pixels = malloc(sizeof(uint32_t) * stride * h);
+    int tiles_x = (w + SWR_TILE - 1) / SWR_TILE, tiles_y = (h + SWR_TILE - 1) / SWR_TILE;
+    struct swr_tile *tiles = calloc(tiles_x * tiles_y, sizeof(struct swr_tile));
+    if (!pixels || !tiles){
+        free(pixels);
+        free(tiles);
+        return -1;
+    }
+    free(r->pixels);
+    free_tiles(r);
+    r->pixels = pixels;
+    r->tiles = tiles;
+    r->tiles_x = tiles_x;
+    r->tiles_y = tiles_y;
+    r->width = w;
+    r->height = h;
+    r->stride = stride;
+    memset(r->pixels, 0, sizeof(uint32_t) * stride * h);
+    return 0;
+}
+
+int swr_init(struct swr *r, int w, int h, int n_threads)
+{
+    memset(r, 0, sizeof *r);
+    if (swr_resize(r, w, h) < 0)
+        return -1;
+    if (n_threads <= 0)
+        n_threads = SDL_GetCPUCount();
+    if (n_threads > SWR_THREADS_MAX)
+        n_threads = SWR_THREADS_MAX;
+    r->n_threads = 1;
+    r->start = SDL_CreateSemaphore(0);
+    r->done = SDL_CreateSemaphore(0);
+    if (!r->start || !r->done){
+        swr_free(r);
+        return -1;
+    }
+    for (int i = 1; i < n_threads; i++){
+        r->threads[i] = SDL_CreateThread(worker, "swr", r);
+        if (!r->threads[i])
+            break;
+        r->n_threads++;
+    }
+    return 0;
+}
+
+void swr_free(struct swr *r)
+{
+    r->quit = 1;
+    for (int i = 1; i < r->n_threads; i++)
+        SDL_SemPost(r->start);
+    for (int i = 1; i < r->n_threads; i++)
+        SDL_WaitThread(r->threads[i], NULL);
+    if (r->start)
+        SDL_DestroySemaphore(r->start);
+    if (r->done)
+        SDL_DestroySemaphore(r->done);
+    free_tiles(r);
+    free(r->pixels);
+    free(r->prims);
+    memset(r, 0, sizeof *r);
+}
+
+static uint32_t pack(uint8_t rgba[4])
+{
+    uint32_t c;
+    memcpy(&c, rgba, sizeof c);
+    return c;
+}
+
+void swr_clear(struct swr *r, uint8_t rgba[4])
+{
+    uint32_t c = pack(rgba);
+    for (int i = 0; i < r->stride * r->height; i++)
+        r->pixels[i] = c;
+    r->n_prims = 0;
+}
+
+static struct swr_prim *new_prim(struct swr *r)
+{
+    if (grow((void **) &r->prims, &r->prims_cap, r->n_prims + 1, sizeof(struct swr_prim)) < 0)
+        return NULL;
+    return &r->prims[r->n_prims++];
+}
+
+static float snap(float v)
+{
+    return floorf(v * SUBPIXEL + 0.5f) / SUBPIXEL;
+}
+
+int swr_triangle(struct swr *r, vec2 a, vec2 b, vec2 c, uint8_t rgba[4])
+{
+    struct swr_prim *p = new_prim(r);
+    if (!p)
+        return -1;
+    p->type = SWR_TRIANGLE;
+    p->x[0] = snap(a[0]); p->y[0] = snap(a[1]);
+    p->x[1] = snap(b[0]); p->y[1] = snap(b[1]);
+    p->x[2] = snap(c[0]); p->y[2] = snap(c[1]);
+    //make the winding positive so inside means all edges >= 0
+    float area = (p->x[1] - p->x[0]) * (p->y[2] - p->y[0]) - (p->y[1] - p->y[0]) * (p->x[2] - p->x[0]);
+    if (area == 0.0f){
+        r->n_prims--;
+        return 0;
+    }
+    if (area < 0.0f){
+        float tx = p->x[1], ty = p->y[1];
+        p->x[1] = p->x[2]; p->y[1] = p->y[2];
+        p->x[2] = tx;      p->y[2] = ty;
+    }
+    memcpy(p->rgba, rgba, 4);
+    return 0;
+}
+
+int swr_point(struct swr *r, float x, float y, uint8_t rgba[4])
+{
+    struct swr_prim *p = new_prim(r);
+    if (!p)
+        return -1;
+    p->type = SWR_POINT;
+    p->x[0] = x;
+    p->y[0] = y;
+    memcpy(p->rgba, rgba, 4);
+    return 0;
+}
+
+int swr_draw_ui(struct swr *r, const uvec2 *v, int first_point, int n)
+{
+    for (int i = 0; i + 2 < first_point; i += 3){
+        vec2 a = { v[i].x, v[i].y }, b = { v[i + 1].x, v[i + 1].y }, c = { v[i + 2].x, v[i + 2].y };
+        if (swr_triangle(r, a, b, c, (uint8_t *) v[i].rgb) < 0)
+            return -1;
+    }
+    for (int i = first_point; i < n; i++)
+        if (swr_point(r, v[i].x, v[i].y, (uint8_t *) v[i].rgb) < 0)
+            return -1;
+    return 0;
+}
+
+int swr_draw_vertices(struct swr *r, const struct vertex *v, int n, const float *mvp)
+{
+    mat4x4 m;
+    memcpy(m, mvp, sizeof m);
+    for (int i = 0; i + 2 < n; i += 3){
+        vec2 s[3];
+        for (int j = 0; j < 3; j++){
+            vec4 p = { v[i + j].pos[0], v[i + j].pos[1], 1.0f, 1.0f }, o;
+            mat4x4_mul_vec4(o, m, p);
+            s[j][0] = (o[0] / o[3] + 1.0f) * 0.5f * r->width;
+            s[j][1] = (1.0f - o[1] / o[3]) * 0.5f * r->height;
+        }
+        uint8_t rgba[4] = { v[i].rgb[0], v[i].rgb[1], v[i].rgb[2], 255 };
+        if (swr_triangle(r, s[0], s[1], s[2], rgba) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int bin(struct swr *r)
+{
+    for (int i = 0; i < r->tiles_x * r->tiles_y; i++)
+        r->tiles[i].n = 0;
+    for (int i = 0; i < r->n_prims; i++){
+        struct swr_prim *p = &r->prims[i];
+        float minx = p->x[0], maxx = p->x[0], miny = p->y[0], maxy = p->y[0];
+        if (p->type == SWR_TRIANGLE){
+            for (int j = 1; j < 3; j++){
+                if (p->x[j] < minx) minx = p->x[j];
+                if (p->x[j] > maxx) maxx = p->x[j];
+                if (p->y[j] < miny) miny = p->y[j];
+                if (p->y[j] > maxy) maxy = p->y[j];
+            }
+        }
+        if (maxx < 0.0f || maxy < 0.0f || minx >= r->width || miny >= r->height)
+            continue;
+        int tx0 = minx < 0.0f ? 0 : (int) minx / SWR_TILE;
+        int ty0 = miny < 0.0f ? 0 : (int) miny / SWR_TILE;
+        int tx1 = maxx >= r->width  ? r->tiles_x - 1 : (int) maxx / SWR_TILE;
+        int ty1 = maxy >= r->height ? r->tiles_y - 1 : (int) maxy / SWR_TILE;
+        for (int ty = ty0; ty <= ty1; ty++){
+            for (int tx = tx0; tx <= tx1; tx++){
+                struct swr_tile *t = &r->tiles[ty * r->tiles_x + tx];
+                if (grow((void **) &t->prims, &t->cap, t->n + 1, sizeof(int)) < 0)
+                    return -1;
+                t->prims[t->n++] = i;
+            }
+        }
+    }
+    return 0;
+}
+
+struct edge{
+    float a, b, c; //E(x, y) = a * x + b * y + c
+    float bias;    //0 on top-left edges, a hair above 0 elsewhere (fill rule)
+};
+
+static void setup_edge(struct edge *e, float x0, float y0, float x1, float y1)
+{
+    e->a = y0 - y1;
+    e->b = x1 - x0;
+    e->c = x0 * y1 - y0 * x1;
+    //y down with positive winding: top edges are horizontal going right,
+    //left edges go up
+    int top = y0 == y1 && x1 > x0;
+    int left = y1 < y0;
+    e->bias = top || left ? 0.0f : 1.0f / (SUBPIXEL * SUBPIXEL * 4.0f);
+}
+
+static void raster_triangle(struct swr *r, struct swr_prim *p, int x0, int y0, int x1, int y1)
+{
+    struct edge e[3];
+    setup_edge(&e[0], p->x[1], p->y[1], p->x[2], p->y[2]);
+    setup_edge(&e[1], p->x[2], p->y[2], p->x[0], p->y[0]);
+    setup_edge(&e[2], p->x[0], p->y[0], p->x[1], p->y[1]);
+
+    //clip the tile to the triangle's bounds
+    float minx = fminf(p->x[0], fminf(p->x[1], p->x[2])), maxx = fmaxf(p->x[0], fmaxf(p->x[1], p->x[2]));
+    float miny = fminf(p->y[0], fminf(p->y[1], p->y[2])), maxy = fmaxf(p->y[0], fmaxf(p->y[1], p->y[2]));
+    if ((int) floorf(minx) > x0) x0 = (int) floorf(minx);
+    if ((int) floorf(miny) > y0) y0 = (int) floorf(miny);
+    if ((int) ceilf(maxx) < x1) x1 = (int) ceilf(maxx);
+    if ((int) ceilf(maxy) < y1) y1 = (int) ceilf(maxy);
+    x0 &= ~3;
+    uint32_t color = pack(p->rgba);
+
+#ifdef __SSE2__
+    __m128 a0 = _mm_set1_ps(e[0].a), a1 = _mm_set1_ps(e[1].a), a2 = _mm_set1_ps(e[2].a);
+    __m128 b0 = _mm_set1_ps(e[0].bias), b1 = _mm_set1_ps(e[1].bias), b2 = _mm_set1_ps(e[2].bias);
+    __m128 lane = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    __m128i col = _mm_set1_epi32(color);
+    __m128 xmax = _mm_set1_ps((float) x1);
+    for (int y = y0; y < y1; y++){
+        float cy = y + 0.5f;
+        __m128 r0 = _mm_set1_ps(e[0].b * cy + e[0].c);
+        __m128 r1 = _mm_set1_ps(e[1].b * cy + e[1].c);
+        __m128 r2 = _mm_set1_ps(e[2].b * cy + e[2].c);
+        uint32_t *row = r->pixels + y * r->stride;
+        for (int x = x0; x < x1; x += 4){
+            __m128 xs = _mm_add_ps(_mm_set1_ps((float) x), lane);
+            __m128 w0 = _mm_add_ps(_mm_mul_ps(a0, xs), r0);
+            __m128 w1 = _mm_add_ps(_mm_mul_ps(a1, xs), r1);
+            __m128 w2 = _mm_add_ps(_mm_mul_ps(a2, xs), r2);
+            __m128 m = _mm_and_ps(_mm_cmpge_ps(w0, b0), _mm_cmpge_ps(w1, b1));
+            m = _mm_and_ps(m, _mm_cmpge_ps(w2, b2));
+            m = _mm_and_ps(m, _mm_cmplt_ps(xs, xmax)); //tile / framebuffer edge
+            int bits = _mm_movemask_ps(m);
+            if (!bits)
+                continue;
+            __m128i *dst = (__m128i *) (row + x);
+            if (bits == 0xF){
+                _mm_storeu_si128(dst, col);
+                continue;
+            }
+            __m128i mi = _mm_castps_si128(m);
+            __m128i old = _mm_loadu_si128(dst);
+            _mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(mi, col), _mm_andnot_si128(mi, old)));
+        }
+    }
+#else
+    for (int y = y0; y < y1; y++){
+        float cy = y + 0.5f;
+        uint32_t *row = r->pixels + y * r->stride;
+        for (int x = x0; x < x1; x++){
+            float cx = x + 0.5f;
+            if (e[0].a * cx + e[0].b * cy + e[0].c >= e[0].bias &&
+                e[1].a * cx + e[1].b * cy + e[1].c >= e[1].bias &&
+                e[2].a * cx + e[2].b * cy + e[2].c >= e[2].bias)
+                row[x] = color;
+        }
+    }
+#endif
+}
+
+static void raster_tile(struct swr *r, int t)
+{
+    struct swr_tile *tile = &r->tiles[t];
+    int x0 = (t % r->tiles_x) * SWR_TILE, y0 = (t / r->tiles_x) * SWR_TILE;
+    int x1 = x0 + SWR_TILE < r->width ? x0 + SWR_TILE : r->width;
+    int y1 = y0 + SWR_TILE < r->height ? y0 + SWR_TILE : r->height;
+    for (int i = 0; i < tile->n; i++){
+        struct swr_prim *p = &r->prims[tile->prims[i]];
+        if (p->type == SWR_POINT){
+            int x = (int) p->x[0], y = (int) p->y[0];
+            if (x >= x0 && x < x1 && y >= y0 && y < y1)
+                r->pixels[y * r->stride + x] = pack(p->rgba);
+            continue;
+        }
+        raster_triangle(r, p, x0, y0, x1, y1);
+    }
+}
+
+void swr_flush(struct swr *r)
+{
+    if (!r->n_prims)
+        return;
+    PROF_ZONE("swr_flush");
+    if (bin(r) < 0){
+        //out of memory, draw nothing rather than half a frame
+        r->n_prims = 0;
+        return;
+    }
+    SDL_AtomicSet(&r->next_tile, 0);
+    for (int i = 1; i < r->n_threads; i++)
+        SDL_SemPost(r->start);
+    int t;
+    while ((t = SDL_AtomicAdd(&r->next_tile, 1)) < r->tiles_x * r->tiles_y)
+        raster_tile(r, t);
+    for (int i = 1; i < r->n_threads; i++)
+        SDL_SemWait(r->done);
+    r->n_prims = 0;
+}
@@ -0,0 +1,74 @@
+#ifndef SWR_H
+#define SWR_H
+
+#include <stdint.h>
+#include <SDL.h>
+#include "glad/glad.h" //ui.h needs the GL types
+#include "lin.h"
+#include "phys.h"
+#include "ui.h"
+
+/*
+ * cpu rasterizer for machines without a GPU, and a reference renderer.
+ * primitives are queued in submission order, binned into 64x64 tiles on
+ * flush and tiles are rasterized in parallel, 4 pixels at a time with SSE2
+ * edge functions. the framebuffer is RGBA8, top row first, and like the GL
+ * path there is no blending: alpha is written through.
+ */
+
+#define SWR_TILE 64
+#define SWR_THREADS_MAX 16
+
+enum swr_prim_type{
+    SWR_TRIANGLE,
+    SWR_POINT,
+};
+
+struct swr_prim{
+    enum swr_prim_type type;
+    float x[3], y[3]; //pixels, y down
+    uint8_t rgba[4];
+};
+
+struct swr_tile{
+    int *prims;
+    int n;
+    int cap;
+};
+
+struct swr{
+    int width;
+    int height;
+    int stride;       //pixels per row, multiple of 4
+    uint32_t *pixels; //RGBA bytes in memory order
+
+    struct swr_prim *prims;
+    int n_prims;
+    int prims_cap;
+
+    int tiles_x, tiles_y;
+    struct swr_tile *tiles;
+
+    int n_threads; //including the calling thread
+    SDL_Thread *threads[SWR_THREADS_MAX];
+    SDL_sem *start;
+    SDL_sem *done;
+    SDL_atomic_t next_tile;
+    int quit;
+};
+
+//n_threads <= 0 picks the CPU count
+int  swr_init(struct swr *r, int w, int h, int n_threads);
+void swr_free(struct swr *r);
+int  swr_resize(struct swr *r, int w, int h);
+void swr_clear(struct swr *r, uint8_t rgba[4]);
+int  swr_triangle(struct swr *r, vec2 a, vec2 b, vec2 c, uint8_t rgba[4]);
+int  swr_point(struct swr *r, float x, float y, uint8_t rgba[4]);
+//same data ui_render() draws: [0, first_point) triangles, the rest points
+int  swr_draw_ui(struct swr *r, const uvec2 *v, int first_point, int n);
+//tri2.c triangles, mvp maps them to clip space like the vertex shader
+int  swr_draw_vertices(struct swr *r, const struct vertex *v, int n, const float *mvp);
+//rasterizes everything queued since the last flush
+void swr_flush(struct swr *r);
+
+#endif
@@ -2,16 +2,17 @@
 #include "glad/glad.h"
 #include "common.h"
 #include "lin.h"
+#include "camera.h"
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include "checks.h"
+#include "gfx.h"
 
 #define SCREEN_WIDTH 1280
 #define SCREEN_HEIGHT 720
 
 char keys[256] = {0};
-static void check_sdl(const char *line);
 
 struct state_s {
     char running;
@@ -20,15 +21,18 @@ struct state_s {
     vec4 bg;
 
     SDL_Event event;
-    SDL_Window *window;
-    SDL_GLContext *gl;
+    struct gfx gfx;
 
     GLuint  prg;
     GLuint  pos_loc;
     GLuint  u_color_loc;
+    GLuint  u_mat_loc;
     GLuint  pos_buff;
     GLuint  vao;
 
+    struct camera cam;
+    unsigned cam_version; //camera version last uploaded to u_mat
+
     struct {
         float dt;
         uint64_t last;
@@ -49,62 +53,31 @@ int veccount = 0;
 static void handle_event(void);
 static void update(void);
 static void draw(void);
-static void shader_die(GLuint shd, const char *msg);
 static void initialize(void);
 static void push_vec(vec2);
-static void normalize_v2(vec2);
 
 int main(void)
 {
     if(SDL_Init(SDL_INIT_EVERYTHING) < 0) {
         die("no sdl");
     }
+    if (log_start(stderr, LOG_MIN_LEVEL) < 0)
+        die("log_start failed");
 
 
 
+    if (gfx_init(&state.gfx, "hmm", SCREEN_WIDTH, SCREEN_HEIGHT, GFX_WINDOW | GFX_GL) < 0)
+        die("%s", state.gfx.last_error);
     check_sdl(LINEFILESTR);
-    state.window = SDL_CreateWindow( "hmm", 
-        SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 
-        SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_OPENGL);
-    if (!state.window)
-        die("no window");
-    check_sdl(LINEFILESTR);
-
-
-    SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
-    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
-    SDL_GL_LoadLibrary(NULL); 
-
-
-
-    state.gl = SDL_GL_CreateContext(state.window);
-    if (!state.gl)
-        die("no gl");
-    check_sdl(LINEFILESTR);
-
-
-    gladLoadGLLoader(SDL_GL_GetProcAddress);
-
-
     SDL_GL_SetSwapInterval(0);
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_CULL_FACE);
-
-    SDL_GetWindowSize(state.window, &state.w, &state.h);
-    glViewport(0, 0, state.w, state.h);
+    state.w = state.gfx.w;
+    state.h = state.gfx.h;
     printf("w%d h%d\n", state.w, state.h);
 
-    if(SDL_GL_MakeCurrent(state.window, state.gl) < 0){
-        check_sdl(LINEFILESTR);
-    }
-
     initialize();
 
     while (state.running) {
-        SDL_GL_SwapWindow(state.window);
+        SDL_GL_SwapWindow(state.gfx.window);
         while (SDL_PollEvent(&state.event)) {
             if (state.event.type == SDL_QUIT) 
                 goto end;
@@ -116,8 +89,8 @@ int main(void)
 end:
 
 
-    SDL_DestroyWindow(state.window);
-    SDL_GL_DeleteContext(state.gl);
+    gfx_free(&state.gfx);
+    log_stop();
     SDL_Quit();
     return 0;
 }
@@ -130,14 +103,15 @@ static void handle_event(void){
             keys[state.event.key.keysym.sym] = state.event.type == SDL_KEYDOWN;
     }
     else if (state.event.type == SDL_WINDOWEVENT){
-        SDL_GetWindowSize(state.window, &state.w, &state.h);
+        SDL_GetWindowSize(state.gfx.window, &state.w, &state.h);
         glViewport(0, 0, state.w, state.h);
+        camera_set_viewport(&state.cam, state.w, state.h);
     }
     if (state.event.type == SDL_MOUSEBUTTONDOWN){
-        vec2 v = {state.event.button.x, state.event.button.y};
-        printf("(x: %f, y: %f)\n", v[0], v[1]);
-        normalize_v2(v);
-        printf("(x: %f, y: %f)\n", v[0], v[1]);
+        vec2 v;
+        camera_unproject(&state.cam, v, state.event.button.x, state.event.button.y);
+        LOG_DEBUG("(x: %d, y: %d) -> (x: %f, y: %f)\n",
+                  state.event.button.x, state.event.button.y, v[0], v[1]);
         push_vec(v);
     }
 
@@ -154,7 +128,7 @@ void update_time()
     state.time.dt = (now - state.time.last) / (float) state.time.freq;
     state.time.last = now;
     if (!(state.time.tick++ % 2321))
-        printf("dt: %f", state.time.dt);
+        LOG_DEBUG("dt: %f\n", state.time.dt);
 }
 static void update()
 {
@@ -179,12 +153,13 @@ static void push_vec(vec2 v)
     needs_refresh = 1;
     memcpy(vectors + veccount++, v, sizeof(vec2));
 }
-static void normalize_v2(vec2 v){
-    v[0] = (v[0] / state.w - 0.5) * 2.0;
-    v[1] = (v[1] / state.h - 0.5) * -2.0;
-}
 static void draw_polygons()
 {
+    float *m = camera_matrix(&state.cam);
+    if (state.cam.version != state.cam_version){
+        state.cam_version = state.cam.version;
+        glUniformMatrix4fv(state.u_mat_loc, 1, GL_FALSE, m);
+    }
     if (needs_refresh){
         needs_refresh = 0;
         glBindVertexArray(state.vao);
@@ -200,7 +175,7 @@ static void draw(){
     glClearColor(state.bg[0], state.bg[1], state.bg[2], state.bg[3]);
     if (bg0 != (state.bg[0]+ state.bg[1]+ state.bg[2]+ state.bg[3])){
         bg0 = (state.bg[0]+ state.bg[1]+ state.bg[2]+ state.bg[3]);
-        printf("bg: %f %f %f %f\n", state.bg[0], state.bg[1], state.bg[2], state.bg[3]);
+        LOG_DEBUG("bg: %f %f %f %f\n", state.bg[0], state.bg[1], state.bg[2], state.bg[3]);
     }
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     draw_polygons();
@@ -216,8 +191,9 @@ static void initialize(){
     const char * vsh_src = 
         "#version 330\n"
         "in vec2 pos;\n"
+        "uniform mat4 u_mat;\n"
         "void main(void){\n"
-        "gl_Position = vec4(pos, 1, 1);\n"
+        "gl_Position = u_mat * vec4(pos, 1, 1);\n"
         "}\n";
     const char * fgsh_src = 
         "#version 330\n"
@@ -227,42 +203,18 @@ static void initialize(){
         "void main(void){\n"
         "color = u_color;\n"
         "}\n";
-    GLuint prg = glCreateProgram();
-    state.prg = prg;
-    if( prg < 0)
-        die("prog < 0");
-    GLuint vsh = glCreateShader(GL_VERTEX_SHADER);
-    GLuint fgsh = glCreateShader(GL_FRAGMENT_SHADER);
-
-    int vshlen = strlen(vsh_src);
-    int fgshlen = strlen(fgsh_src);
-    glShaderSource(vsh, 1, &vsh_src, &vshlen);
-    glShaderSource(fgsh, 1, &fgsh_src, &fgshlen);
-    glCompileShader(vsh);
-    glCompileShader(fgsh);
-    GLint status;
-    glGetShaderiv(vsh, GL_COMPILE_STATUS, &status);
-    if (status != GL_TRUE)
-        shader_die(vsh, "vsh");
-    glGetShaderiv(fgsh, GL_COMPILE_STATUS, &status);
-    if (status != GL_TRUE)
-        shader_die(fgsh, "fgsh");
-    glAttachShader(prg, vsh);
-    glAttachShader(prg, fgsh);
-    glDeleteShader(vsh);
-    glDeleteShader(fgsh);
-
-    glLinkProgram(prg);
-    glGetProgramiv(prg, GL_LINK_STATUS, &status);
-    if (status != GL_TRUE)
-        die("program linking failed");
-    glFlush();
+    const char *err;
+    if (gfx_program(&state.prg, vsh_src, fgsh_src, &err) < 0)
+        die("shaders: %s", err);
     
-    glUseProgram(prg);
+    glUseProgram(state.prg);
     glGenBuffers(1, &state.pos_buff);
     glGenVertexArrays(1, &state.vao);
     state.u_color_loc = glGetUniformLocation(state.prg, "u_color");
     state.pos_loc = glGetAttribLocation(state.prg, "pos");
+    state.u_mat_loc = glGetUniformLocation(state.prg, "u_mat");
+    camera_init(&state.cam, CAMERA_WORLD, state.w, state.h);
+    state.cam_version = state.cam.version;
     check_gl(LINEFILESTR);
 
     if ((int) state.vao < 0 || (int) state.u_color_loc < 0 || (int) state.pos_loc < 0 || (int) state.pos_buff < 0){
@@ -300,10 +252,3 @@ static void initialize(){
     
 }
 
-static void check_sdl(const char *line){
-   const char *m = SDL_GetError(); 
-   if (m){
-        printf( "SDL LAST ERROR: %s\n"
-                "at %s\n", m, line);
-   }
-}
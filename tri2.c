@@ -1,10 +1,26 @@
 #include "common.h"
 #include <math.h>
+#include <unistd.h>
 #include <SDL.h>
 #include "glad/glad.h"
 #include "checks.h"
 #include "lin.h"
+#include "camera.h"
+#include "phys.h"
 #include "ui.h"
+#include "swr.h"
+#include "capture.h"
+#include "replay.h"
+#include "scene.h"
+#include "stream.h"
+#include "prof.h"
+#include "gputime.h"
+#include "overlay.h"
+#include "pace.h"
+#include "input.h"
+#include "log.h"
+#include "gfx.h"
+#include "pfont.h"
 
 #define SCREEN_WIDTH 1280
 #define SCREEN_HEIGHT 720
@@ -15,21 +31,34 @@ char keys[256] = {0};
 struct state_s {
     char running;
     char fps_info;
+    char soft; //-soft: software rasterizer, no GL context
+    char headless; //-headless: soft without a window, unpaced
+    float fixed_dt; //> 0 while recording or replaying
+    uint32_t seed;
+    const char *scene_path; //-scene: loaded at start, 's' saves to it
+    char stream; //-stream: page resting triangles out, stream scenes in
+    const char *font_path; //-font: a packed font for the ui, see pfont.h
+    struct pfont font;
+    enum pace_mode pace_mode; //-vsync, -uncapped, -fps <hz>: fixed rate
+    double pace_rate;
     int w;
     int h;
     vec4 bg;
 
     SDL_Event event;
-    SDL_Window *window;
-    SDL_GLContext *gl;
+    struct gfx gfx;
 
     GLuint  prg;
     GLuint  a_pos_loc;
     GLuint  a_color_loc;
     GLuint  u_color_loc;
-    GLuint  pos_buff;
+    GLuint  u_mat_loc;
+    struct gfx_stream tris; //world.vertices, sized for world.cap
     GLuint  vao;
 
+    struct camera cam;
+    unsigned cam_version; //camera version last uploaded to u_mat
+
     struct {
         float dt;
         float accum;
@@ -37,117 +66,302 @@ struct state_s {
         uint64_t freq;
         uint64_t tick;
         uint64_t frame;
+        float slept; //in the pacer or a vsync swap, accum - slept is cpu + driver time
     } time;
+    struct pacer pace;
+    struct input input;
+
+    struct gputime gpu;
+    int pass_tri;
+    int pass_ui;
+
+    struct overlay ov; //'f', with the stderr fps line
+    int z_events, z_physics, z_stream, z_draw;
+    int p_tris, p_ui, p_staging, p_capture;
 
 } static state;
 
-struct vertex{
-    vec2 pos;
-    vec2 vel;
-    uint8_t rgb[3];
-};
 // [ 0 .. 2 ]
 int entered_vertices = 0;
+vec2 entered[3];
 
-#define VECMAX 1000
-struct vertex vertices[VECMAX];
-int needs_refresh = 0;
-int trcount = 0;
+#define TRI_MAX 100000
+struct phys_world world;
+static struct ui ui;
+struct swr swr;
+struct capture cap;
+struct replay rp;
+struct stream strm;
 
 
-static void handle_event(void);
+static void handle_event(int ui_hit);
 static void update(void);
 static void draw(void);
-static void shader_die(GLuint shd, const char *msg);
-static void prog_die(GLuint prg, const char *msg);
 static void initialize(void);
+static void initialize_gl(void);
 static void push_vec(vec2);
-static void normalize_v2(vec2);
 static void dump_vertices();
-static void check_sdl(const char *line);
+static uint32_t world_hash(void);
+static void load_scene(const char *path);
 
-int main(void)
+int main(int argc, char **argv)
 {
-    if(SDL_Init(SDL_INIT_EVERYTHING) < 0) {
-        die("no sdl");
+    const char *capture_path = NULL;
+    const char *record_path = NULL;
+    const char *replay_path = NULL;
+    const char *trace_path = "trace.json";
+    for (int i=1; i<argc; i++){
+        if (strcmp(argv[i], "-soft") == 0)
+            state.soft = 1;
+        else if (strcmp(argv[i], "-headless") == 0)
+            state.soft = state.headless = 1;
+        else if (strcmp(argv[i], "-capture") == 0 && i + 1 < argc)
+            capture_path = argv[++i];
+        else if (strcmp(argv[i], "-record") == 0 && i + 1 < argc)
+            record_path = argv[++i];
+        else if (strcmp(argv[i], "-replay") == 0 && i + 1 < argc)
+            replay_path = argv[++i];
+        else if (strcmp(argv[i], "-scene") == 0 && i + 1 < argc)
+            state.scene_path = argv[++i];
+        else if (strcmp(argv[i], "-stream") == 0)
+            state.stream = 1;
+        else if (strcmp(argv[i], "-font") == 0 && i + 1 < argc)
+            state.font_path = argv[++i];
+        else if (strcmp(argv[i], "-trace") == 0 && i + 1 < argc)
+            trace_path = argv[++i];
+        else if (strcmp(argv[i], "-vsync") == 0)
+            state.pace_mode = PACE_VSYNC;
+        else if (strcmp(argv[i], "-uncapped") == 0)
+            state.pace_mode = PACE_UNCAPPED;
+        else if (strcmp(argv[i], "-fps") == 0 && i + 1 < argc){
+            state.pace_mode = PACE_FIXED;
+            state.pace_rate = atof(argv[++i]);
+        }
+    }
+    if (state.pace_rate <= 0)
+        state.pace_rate = 60;
+    if (state.headless)
+        state.pace_mode = PACE_UNCAPPED;
+    else if (state.soft && state.pace_mode == PACE_VSYNC)
+        state.pace_mode = PACE_FIXED;
+    state.w = SCREEN_WIDTH;
+    state.h = SCREEN_HEIGHT;
+    state.seed = 0xBADBEEF0;
+    if (replay_path){
+        if (replay_open(&rp, replay_path) < 0)
+            die("%s", rp.last_error);
+        state.w = rp.width;
+        state.h = rp.height;
+        state.seed = rp.seed;
+        state.fixed_dt = rp.dt;
+    }
+    else if (record_path){
+        state.fixed_dt = 1.0f / 60;
+        if (replay_record(&rp, record_path, state.w, state.h, state.seed, state.fixed_dt) < 0)
+            die("%s", rp.last_error);
+    }
+    else if (state.headless){
+        die("-headless needs -replay <file>");
     }
 
+    prof_init();
+    prof_thread_name("main");
+    if(SDL_Init(state.headless ? SDL_INIT_TIMER | SDL_INIT_EVENTS : SDL_INIT_EVERYTHING) < 0) {
+        die("no sdl");
+    }
+    if (log_start(stderr, LOG_MIN_LEVEL) < 0)
+        die("log_start failed");
 
 
-    check_sdl(LINEFILESTR);
-    state.window = SDL_CreateWindow( "hmm", 
-        SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 
-        SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_OPENGL);
-    if (!state.window)
-        die("no window");
-    check_sdl(LINEFILESTR);
-
-    SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
-    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
-    SDL_GL_LoadLibrary(NULL); 
 
-    state.gl = SDL_GL_CreateContext(state.window);
-    if (!state.gl)
-        die("no gl");
+    unsigned gfx_flags = state.headless ? 0 : state.soft ? GFX_WINDOW : GFX_WINDOW | GFX_GL;
+#ifndef NDEBUG
+    //lets the driver report through errcheck's callback
+    gfx_flags |= GFX_DEBUG_GL;
+#endif
+    if (gfx_init(&state.gfx, "hmm", state.w, state.h, gfx_flags) < 0)
+        die("%s", state.gfx.last_error);
     check_sdl(LINEFILESTR);
-
-    gladLoadGLLoader(SDL_GL_GetProcAddress);
-
-    SDL_GL_SetSwapInterval(0);
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_CULL_FACE);
-
-    SDL_GetWindowSize(state.window, &state.w, &state.h);
-    glViewport(0, 0, state.w, state.h);
-    printf("w%d h%d\n", state.w, state.h);
-
-    if(SDL_GL_MakeCurrent(state.window, state.gl) < 0){
-        check_sdl(LINEFILESTR);
+    state.w = state.gfx.w;
+    state.h = state.gfx.h;
+
+    if (!state.soft){
+        static const char *errcheck_names[] = {"glGetError per check", "debug output", "sampled per frame", "off"};
+        LOG_INFO("gl errors: %s\n", errcheck_names[state.gfx.errors]);
+
+        if (state.pace_mode == PACE_VSYNC){
+            //adaptive vsync where the driver has it
+            SDL_DisplayMode mode;
+            if (SDL_GL_SetSwapInterval(-1) < 0 && SDL_GL_SetSwapInterval(1) < 0){
+                LOG_WARN("no vsync, pacing at %.0fhz\n", state.pace_rate);
+                state.pace_mode = PACE_FIXED;
+            }
+            else if (SDL_GetWindowDisplayMode(state.gfx.window, &mode) == 0 && mode.refresh_rate > 0)
+                state.pace_rate = mode.refresh_rate;
+        }
+        if (state.pace_mode != PACE_VSYNC)
+            SDL_GL_SetSwapInterval(0);
+        if (prof_gpu_init(SDL_GL_GetProcAddress) < 0)
+            LOG_WARN("no GL timestamps, gpu zones disabled\n");
+        if (gputime_init(&state.gpu, SDL_GL_GetProcAddress) < 0)
+            LOG_WARN("gputime: %s\n", state.gpu.last_error);
+        state.pass_tri = gputime_add_pass(&state.gpu, "triangles");
+        state.pass_ui = gputime_add_pass(&state.gpu, "ui");
     }
+    LOG_INFO("w%d h%d\n", state.w, state.h);
 
-    initialize();
+    if (state.soft && swr_init(&swr, state.w, state.h, 0) < 0)
+        die("swr_init failed");
 
+    initialize();
+    if (state.stream && stream_init(&strm, &world, 0.5f) < 0)
+        die("%s", strm.last_error);
+    if (state.scene_path && access(state.scene_path, R_OK) == 0)
+        load_scene(state.scene_path);
+    if (capture_path && capture_start(&cap, capture_path, state.w, state.h, 60, !state.soft) < 0)
+        die("%s", cap.last_error);
+    cap.lossless = state.headless;
+    state.p_staging = state.stream ? overlay_add_pool(&state.ov, "staging") : -1;
+    state.p_capture = cap.active ? overlay_add_pool(&state.ov, "capture") : -1;
+
+    pace_init(&state.pace, state.pace_mode, state.pace_rate);
+    uint64_t run_start = SDL_GetPerformanceCounter();
     while (state.running) {
-        SDL_GL_SwapWindow(state.window);
-        while (SDL_PollEvent(&state.event)) {
-            if (state.event.type == SDL_QUIT) 
-                goto end;
-            handle_event();
+        PROF_ZONE("frame");
+        uint64_t t0 = SDL_GetPerformanceCounter();
+        uint64_t waited;
+        {
+            PROF_ZONE("pace");
+            waited = pace_wait(&state.pace);
+        }
+        if (!state.soft){
+            PROF_ZONE("swap");
+            SDL_GL_SwapWindow(state.gfx.window);
+        }
+        //with vsync the swap is where the frame waits
+        if (state.pace.mode == PACE_VSYNC)
+            waited = SDL_GetPerformanceCounter() - t0;
+        state.time.slept += waited / (float) state.time.freq;
+        prof_frame();
+        {
+            PROF_ZONE("events");
+            overlay_zone_begin(&state.ov, state.z_events);
+            input_begin(&state.input);
+            input_drain(&state.input);
+            if (rp.mode == REPLAY_PLAY){
+                //live input would break the replay, only a quit gets through
+                int quit = 0;
+                for (int i = 0; i < state.input.n; i++)
+                    quit |= state.input.ev[i].type == SDL_QUIT;
+                input_begin(&state.input);
+                if (quit)
+                    goto end;
+                while (replay_poll(&rp, &state.event))
+                    input_push(&state.input, &state.event);
+            }
+            input_hit_test(&state.input, &ui);
+            for (int i = 0; i < state.input.n; i++) {
+                state.event = state.input.ev[i];
+                if (state.event.type == SDL_FIRSTEVENT)
+                    continue; //merged into a later event
+                replay_capture(&rp, &state.event);
+                if (state.event.type == SDL_QUIT) 
+                    goto end;
+                handle_event(state.input.hit[i]);
+            }
+            overlay_zone_end(&state.ov, state.z_events);
+        }
+        if (replay_done(&rp))
+            break;
+        {
+            PROF_ZONE("update");
+            update();
+        }
+        {
+            PROF_ZONE("draw");
+            overlay_zone_begin(&state.ov, state.z_draw);
+            draw();
+            overlay_zone_end(&state.ov, state.z_draw);
         }
-        update();
-        draw();
+        overlay_pool(&state.ov, state.p_tris, world.count, world.cap);
+        overlay_pool(&state.ov, state.p_ui, ui.n_pixels, PIX_MAX);
+        overlay_pool(&state.ov, state.p_staging, STREAM_STAGING - strm.n_buf_free, STREAM_STAGING);
+        overlay_pool(&state.ov, state.p_capture,
+                     (cap.pool_head - cap.pool_tail + CAPTURE_POOL) % CAPTURE_POOL, CAPTURE_POOL);
+        overlay_frame(&state.ov, state.time.dt * 1000.0f);
+        {
+            PROF_ZONE("capture");
+            if (state.soft && swr.width >= cap.width && swr.height >= cap.height)
+                capture_frame_rgba(&cap, (uint8_t *) swr.pixels, swr.stride * 4);
+            else if (!state.soft)
+                capture_frame_gl(&cap);
+        }
+        replay_next_frame(&rp);
     }
 end:
 
 
-    SDL_DestroyWindow(state.window);
-    SDL_GL_DeleteContext(state.gl);
+    if (rp.mode != REPLAY_OFF){
+        //compare the hash between the recording and its replays
+        double ms = (SDL_GetPerformanceCounter() - run_start) * 1000.0 / SDL_GetPerformanceFrequency();
+        fprintf(stderr, "%s: %u frames, %u events, %.1fms (%.3fms/frame), world hash %08x\n",
+                rp.mode == REPLAY_PLAY ? "replay" : "record", rp.frame, rp.events,
+                ms, rp.frame ? ms / rp.frame : 0.0, world_hash());
+        replay_close(&rp);
+    }
+    if (prof_write_chrome(trace_path) < 0)
+        fprintf(stderr, "could not write %s\n", trace_path);
+    capture_stop(&cap);
+    if (state.stream)
+        stream_free(&strm);
+    overlay_free(&state.ov);
+    if (state.soft)
+        swr_free(&swr);
+    else {
+        gputime_free(&state.gpu);
+        gfx_stream_free(&state.tris);
+    }
+    ui_free(&ui);
+    pfont_close(&state.font);
+    gfx_free(&state.gfx);
+    log_stop();
     SDL_Quit();
     return 0;
 }
 
 
-static void handle_event(void)
+//ui_hit: the ui element under a button press, from input_hit_test()
+static void handle_event(int ui_hit)
 {
 
     if (state.event.type == SDL_KEYDOWN || state.event.type == SDL_KEYUP){
         if (state.event.key.keysym.sym < sizeof keys)
             keys[state.event.key.keysym.sym] = state.event.type == SDL_KEYDOWN;
     }
-    else if (state.event.type == SDL_WINDOWEVENT){
-        SDL_GetWindowSize(state.window, &state.w, &state.h);
-        glViewport(0, 0, state.w, state.h);
+    else if (state.event.type == SDL_WINDOWEVENT &&
+             state.event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED){
+        state.w = state.event.window.data1;
+        state.h = state.event.window.data2;
+        if (rp.mode == REPLAY_PLAY && state.gfx.window)
+            SDL_SetWindowSize(state.gfx.window, state.w, state.h);
+        if (state.soft)
+            swr_resize(&swr, state.w, state.h);
+        else
+            glViewport(0, 0, state.w, state.h);
+        camera_set_viewport(&state.cam, state.w, state.h);
+        ui_set_screen_dim(&ui, state.w, state.h);
+    }
+    else if (state.event.type == SDL_MOUSEWHEEL){
+        //steps of merged wheel events add up
+        if (state.event.wheel.y)
+            camera_set_zoom(&state.cam, state.cam.zoom * powf(1.1f, state.event.wheel.y));
     }
     if (state.event.type == SDL_MOUSEBUTTONDOWN){
-        int ui_handled = ui_event("Lclick", state.event.button.x, state.event.button.y);
-        if (ui_handled < 0){
-            vec2 v = {state.event.button.x, state.event.button.y};
-            printf("(x: %f, y: %f)\n", v[0], v[1]);
-            normalize_v2(v);
-            printf("(x: %f, y: %f)\n", v[0], v[1]);
+        if (ui_hit < 0 || ui_handle_event(&ui, "Lclick", ui_hit) < 0){
+            vec2 v;
+            camera_unproject(&state.cam, v, state.event.button.x, state.event.button.y);
+            LOG_DEBUG("(x: %d, y: %d) -> (x: %f, y: %f)\n",
+                      state.event.button.x, state.event.button.y, v[0], v[1]);
             push_vec(v);
         }
     }
@@ -157,118 +371,90 @@ static void handle_event(void)
     if (keys[SDLK_f] == 1){
         keys[SDLK_f] = 2;
         state.fps_info = !state.fps_info;
+        state.ov.visible = state.fps_info;
     }
     if (keys[SDLK_d]){
         memcpy(state.bg, (float[4]){ 0.3f, 0.5f, 1.0f, 0.0f}, sizeof(state.bg));
         dump_vertices();
     }
+    if (keys[SDLK_s] == 1){
+        keys[SDLK_s] = 2;
+        const char *path = state.scene_path ? state.scene_path : "scene.tscn";
+        if (scene_save(&world, &ui, path) < 0)
+            LOG_ERROR("scene: could not write %s\n", path);
+        else
+            LOG_INFO("scene: saved %d triangles to %s\n", world.count, path);
+    }
 }
 
 void update_time()
 {
-    const float target_quanta = 1.0 / 60;
     uint64_t now = SDL_GetPerformanceCounter();
     state.time.dt = (now - state.time.last) / (float) state.time.freq;
     state.time.accum += state.time.dt;
     state.time.tick++;
     if (state.time.accum > 1.0){
         if (state.fps_info){
-            fprintf(stderr, "per frame: %.2fms, fps: %ld\n",
+            LOG_INFO("per frame: %.2fms (cpu %.2fms), fps: %ld, awake: %d/%d, paged out: %d\n",
                             state.time.accum / state.time.frame * 1000.0, 
-                            state.time.frame);
+                            (state.time.accum - state.time.slept) / state.time.frame * 1000.0,
+                            state.time.frame, world.n_awake, world.count, strm.stats.paged);
+            //gpu results lag a few frames, close to cpu means gpu bound
+            if (state.gpu.ok)
+                LOG_INFO("    gpu: triangles %.3fms, ui %.3fms, dropped %lu\n",
+                        gputime_avg_ms(&state.gpu, state.pass_tri),
+                        gputime_avg_ms(&state.gpu, state.pass_ui),
+                        (unsigned long) state.gpu.dropped);
+            double mean, sd;
+            pace_interval_ms(&state.pace, &mean, &sd);
+            LOG_INFO("    pace: %.3fms +- %.3fms, worst %.3fms off, missed %lu\n",
+                    mean, sd, state.pace.stats.worst_us / 1000.0,
+                    (unsigned long) state.pace.stats.missed);
         }
+        gputime_reset(&state.gpu);
+        pace_reset_stats(&state.pace);
         state.time.frame = 0;
         state.time.accum = 0.0;
+        state.time.slept = 0.0;
     }
-    if (state.time.dt < target_quanta)
-        SDL_Delay(1000 * (target_quanta - state.time.dt));
-
     state.time.last = now;
 }
 
-#define GRAVITY 0.15
-
-static void rotate_triangle(struct vertex *tri)
-{
-    //other points
-    /* vec2 rotated[3]; */
-    /* float far_x = rotated[0][0]; */
-    /* int far_idx; */
-    /* for (int i=0; i<3; i++){ */
-    /*     //relative to 'around' */
-    /*     vec2_sub(rotated[i], tri->pos[i], tri->pos[]); */
-    /*     if (fabs(rotated[i][0]) > far_x){ */
-    /*         far_x = fabs(rotated[i][0]); */
-    /*         far_idx = i; */
-    /*     } */
-    /* } */
-    //angle of rotation
-    //
-    //
-    //   
-    //  
-    // * * * * * <this 
-    // *     * 
-    //  *  * 
-    //   *
-    //   
-    //
-    
-
-}
-
 static void update()
 {
     update_time();
-    for (int i=0; i < trcount*3; i+=3){
-        char freefalling = 0;
-        int pivot;
-        for (int j=0; j < 3; j++)
-            if (vertices[i+j].pos[1] > -1.0)
-                freefalling++;
-            else 
-                pivot = i;
-
-        if (freefalling >= 3){
-            for (int j=0; j < 3; j++){
-                vertices[i+j].pos[1] -= GRAVITY * state.time.dt;
-            }
-        }
-        else if (freefalling > 1){
-            /* rotate_triangle(&triangles[i]); */
-        }
-        else
-            continue;
-        needs_refresh = 1;
+    {
+        PROF_ZONE("physics");
+        overlay_zone_begin(&state.ov, state.z_physics);
+        phys_step(&world, state.fixed_dt > 0 ? state.fixed_dt : state.time.dt);
+        overlay_zone_end(&state.ov, state.z_physics);
+    }
+    if (state.stream){
+        PROF_ZONE("stream");
+        overlay_zone_begin(&state.ov, state.z_stream);
+        vec2 a, b;
+        camera_unproject(&state.cam, a, 0, 0);
+        camera_unproject(&state.cam, b, state.w, state.h);
+        struct aabb view = {fminf(a[0], b[0]), fminf(a[1], b[1]), fmaxf(a[0], b[0]), fmaxf(a[1], b[1])};
+        stream_update(&strm, &view);
+        overlay_zone_end(&state.ov, state.z_stream);
+        if (strm.last_error)
+            die("%s", strm.last_error);
     }
 }
 
 static void push_vec(vec2 v)
 {
-    int dest = trcount * 3;
-    memcpy(vertices[dest + entered_vertices].pos, v, sizeof(vec2));
+    memcpy(entered[entered_vertices], v, sizeof(vec2));
     entered_vertices++;
     if (entered_vertices >= 3){
         int r = rand();
+        uint8_t rgb[3] = { (uint8_t)(r), (uint8_t)(r >> 8), (uint8_t)(r >> 16) };
         entered_vertices = 0;
-        memset(vertices[dest].vel, 0, sizeof(vec2));
-        vertices[dest].rgb[0] = (uint8_t)(r);
-        vertices[dest].rgb[1] = (uint8_t)(r >> 8);
-        vertices[dest].rgb[2] = (uint8_t)(r >> 16);
-
-        for(int i=1; i<3; i++){
-            memcpy(vertices[dest + i].rgb, vertices[dest].rgb, sizeof(char[3]));
-            memcpy(vertices[dest + i].vel, vertices[dest].vel, sizeof(vec2));
-        }
-        trcount++;
-        needs_refresh = 1;
+        if (phys_add_triangle(&world, entered[0], entered[1], entered[2], rgb) < 0)
+            LOG_WARN("triangle limit reached (%d)\n", world.cap);
     }
 }
-static void normalize_v2(vec2 v)
-{
-    v[0] = (v[0] / state.w - 0.5) * 2.0;
-    v[1] = (v[1] / state.h - 0.5) * -2.0;
-}
 
 
 static void tri_restore_gl_state()
@@ -278,57 +464,112 @@ static void tri_restore_gl_state()
 
 }
 
-static void draw_polygons()
+static void update_camera()
 {
-    if (needs_refresh){
-        needs_refresh = 0;
-        glBindVertexArray(state.vao);
-        glBindBuffer(GL_ARRAY_BUFFER, state.pos_buff);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(struct vertex) * trcount * 3, vertices, GL_STATIC_DRAW);
-
-        //idx, size, type, normalize?, stride, offset
-        glVertexAttribPointer(state.a_pos_loc,   2, GL_FLOAT,         GL_FALSE, 20, (void *) 0);
-
-        /* glVertexAttribPointer(state.a_color_loc, 3, GL_UNSIGNED_BYTE, GL_FALSE, 20, (void *) 16 ); */
-
-        /* VertexAttribIPointer( uint index, int size, enum type, */
-        /* sizei stride, const void *pointer ); */
-        glVertexAttribIPointer(state.a_color_loc, 3, GL_UNSIGNED_BYTE, 20, (void *) 16 ); 
+    float *m = camera_matrix(&state.cam);
+    if (state.cam.version != state.cam_version){
+        state.cam_version = state.cam.version;
+        glUniformMatrix4fv(state.u_mat_loc, 1, GL_FALSE, m);
+    }
+}
 
+static void draw_polygons()
+{
+    PROF_ZONE("draw_polygons");
+    gputime_begin(&state.gpu, state.pass_tri);
+    update_camera();
+    //only triangles that moved since the last frame, sleeping ones never get here
+    if (world.dirty_lo < world.dirty_hi){
+        size_t first = sizeof(struct vertex) * 3 * world.dirty_lo;
+        size_t len = sizeof(struct vertex) * 3 * (world.dirty_hi - world.dirty_lo);
+        gfx_stream_update(&state.tris, first, len, world.vertices + world.dirty_lo * 3);
+        overlay_count(&state.ov, 0, len);
+        phys_clear_dirty(&world);
         check_gl(LINEFILESTR);
 
         /* printf("updated\n"); */
     }
-    glDrawArrays(GL_TRIANGLES, 0, trcount * 3);
+    glDrawArrays(GL_TRIANGLES, 0, world.count * 3);
+    overlay_count(&state.ov, 1, 0);
+    gputime_end(&state.gpu);
+}
+
+static void draw_soft()
+{
+    PROF_ZONE("draw_soft");
+    uint8_t bg[4];
+    for (int i=0; i<4; i++)
+        bg[i] = state.bg[i] * 255.0f;
+    swr_clear(&swr, bg);
+    swr_draw_vertices(&swr, world.vertices, world.count * 3, camera_matrix(&state.cam));
+    phys_clear_dirty(&world);
+
+    ui_flush(&ui);
+    overlay_draw(&state.ov, &ui);
+    if (ui_build(&ui) < 0)
+        LOG_ERROR("ui: %s\n", ui_last_error(&ui));
+    swr_draw_ui(&swr, ui.data.vertices, ui.first_point_vertex, ui.n_vertices);
+    swr_flush(&swr);
+    if (!state.gfx.window)
+        return;
+
+    //RGBA bytes in memory order, whatever the window surface wants
+    SDL_Surface *surf = SDL_GetWindowSurface(state.gfx.window);
+    if (!surf){
+        check_sdl(LINEFILESTR);
+        return;
+    }
+    int w = surf->w < swr.width  ? surf->w : swr.width;
+    int h = surf->h < swr.height ? surf->h : swr.height;
+    if (SDL_LockSurface(surf) == 0){
+        SDL_ConvertPixels(w, h, SDL_PIXELFORMAT_RGBA32, swr.pixels, swr.stride * 4,
+                          surf->format->format, surf->pixels, surf->pitch);
+        SDL_UnlockSurface(surf);
+    }
+    SDL_UpdateWindowSurface(state.gfx.window);
 }
 
 static void draw()
 {
     static float bg0 = 0.0;
     state.time.frame++;
-    glClearColor(state.bg[0], state.bg[1], state.bg[2], state.bg[3]);
     if (bg0 != (state.bg[0]+ state.bg[1]+ state.bg[2]+ state.bg[3])){
         bg0 = (state.bg[0]+ state.bg[1]+ state.bg[2]+ state.bg[3]);
-        printf("bg: %f %f %f %f\n", state.bg[0], state.bg[1], state.bg[2], state.bg[3]);
+        LOG_DEBUG("bg: %f %f %f %f\n", state.bg[0], state.bg[1], state.bg[2], state.bg[3]);
+    }
+    if (state.soft){
+        draw_soft();
+        return;
     }
+    glClearColor(state.bg[0], state.bg[1], state.bg[2], state.bg[3]);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     draw_polygons();
 
 
-    ui_flush();
+    ui_flush(&ui);
+    overlay_draw(&state.ov, &ui);
     /* for (int i=100; i<200; i++){ */
     /*     for (int j=100; j<200; j++){ */
-    /*         ui_put_pixel(i, j, 0xFFFFFFFF); */
+    /*         ui_put_pixel(&ui, i, j, 0xFFFFFFFF); */
     /*     } */
     /* } */
-    ui_display();
+    {
+        PROF_ZONE("ui_display");
+        gputime_begin(&state.gpu, state.pass_ui);
+        ui_display(&ui);
+        gputime_end(&state.gpu);
+        overlay_count(&state.ov, ui.draw_calls, ui.upload_bytes);
+    }
     tri_restore_gl_state();
+    gputime_frame(&state.gpu);
+    errcheck_frame();
 }
 
 
 static void dump_vertices()
 {
-    printf("trcount: %d\n", trcount);
+    struct vertex *vertices = world.vertices;
+    printf("trcount: %d\n", world.count);
     printf("struct vertex: \n"
             "   size: %lu\n"
             "   sizeof pos:%lu       offsetof pos: %lu\n"
@@ -337,7 +578,7 @@ static void dump_vertices()
             sizeof(vec2), offsetof(struct vertex, pos),
             sizeof(vec2), offsetof(struct vertex, vel),
             sizeof(char[3]), offsetof(struct vertex, rgb));
-    for (int i=0; i < trcount; i++){
+    for (int i=0; i < world.count; i++){
             printf("%d:\n", i);
             printf("\trgb: %hhu %hhu %hhu\n", vertices[i*3].rgb[0], vertices[i*3].rgb[1], vertices[i*3].rgb[2]);
         for (int j = 0; j<3; j++){
@@ -362,29 +603,23 @@ void *cb_rectangle(void *_)
     push_vec((float [2]) {-0.4f, -0.2f});
     push_vec((float [2]) {-0.4f, -0.4f});
     //cheat and set same color
-    for (int i=trcount*3-1; i>trcount*3-3-1; i--){
-        memcpy(vertices[i].rgb, vertices[i-3].rgb, sizeof(char[3]));
+    for (int i=world.count*3-1; i>world.count*3-3-1; i--){
+        memcpy(world.vertices[i].rgb, world.vertices[i-3].rgb, sizeof(char[3]));
 
     }
     return NULL;
 }
 
-static void initialize()
+static void initialize_gl()
 {
-    state.running = 1;
-
-
-    memcpy(state.bg, (float[4]){0.0f, 0.5f, 1.0f, 0.0f}, sizeof(state.bg));
-    state.time.freq = SDL_GetPerformanceFrequency();
-    state.time.last = SDL_GetPerformanceCounter();
-    srand(0xBADBEEF0);
     const char * vsh_src = 
         "#version 330\n"
         "in vec2  a_pos;\n"
         "in ivec3 a_color;\n"
+        "uniform mat4 u_mat;\n"
         "out vec4 v_color;\n"
         "void main(void){\n"
-        "   gl_Position = vec4(a_pos.xy, 1, 1);\n"
+        "   gl_Position = u_mat * vec4(a_pos.xy, 1, 1);\n"
         "   v_color = vec4(a_color, 255.0) / 255.0;\n"
         "}\n";
     const char * fgsh_src = 
@@ -396,67 +631,140 @@ static void initialize()
         "void main(void){\n"
         "   color = v_color;\n"
         "}\n";
-    GLuint prg = glCreateProgram();
-    state.prg = prg;
-    if( prg < 0)
-        die("prog < 0");
-    GLuint vsh = glCreateShader(GL_VERTEX_SHADER);
-    GLuint fgsh = glCreateShader(GL_FRAGMENT_SHADER);
-
-    int vshlen = strlen(vsh_src);
-    int fgshlen = strlen(fgsh_src);
-    glShaderSource(vsh, 1, &vsh_src, &vshlen);
-    glShaderSource(fgsh, 1, &fgsh_src, &fgshlen);
-    glCompileShader(vsh);
-    glCompileShader(fgsh);
-    GLint status;
-    glGetShaderiv(vsh, GL_COMPILE_STATUS, &status);
-    if (status != GL_TRUE)
-        shader_die(vsh, "vsh");
-    glGetShaderiv(fgsh, GL_COMPILE_STATUS, &status);
-    if (status != GL_TRUE)
-        shader_die(fgsh, "fgsh");
-    glAttachShader(prg, vsh);
-    glAttachShader(prg, fgsh);
-    glDeleteShader(vsh);
-    glDeleteShader(fgsh);
-
-    glLinkProgram(prg);
-    glGetProgramiv(prg, GL_LINK_STATUS, &status);
-    if (status != GL_TRUE)
-        prog_die(prg,"program linking failed");
-    glFlush();
+    const char *err;
+    if (gfx_program(&state.prg, vsh_src, fgsh_src, &err) < 0)
+        die("shaders: %s", err);
     
-    glUseProgram(prg);
-    glGenBuffers(1, &state.pos_buff);
+    glUseProgram(state.prg);
     glGenVertexArrays(1, &state.vao);
     glBindVertexArray(state.vao);
     state.a_pos_loc   = glGetAttribLocation(state.prg, "a_pos");
     state.a_color_loc = glGetAttribLocation(state.prg, "a_color");
     state.u_color_loc = glGetUniformLocation(state.prg, "u_color");
+    state.u_mat_loc   = glGetUniformLocation(state.prg, "u_mat");
     check_gl(LINEFILESTR);
 
     if ((int) state.vao < 0         ||
         (int) state.u_color_loc < 0 ||
         (int) state.a_color_loc < 0 ||
-        (int) state.a_pos_loc < 0     ||
-        (int) state.pos_buff < 0  )  
+        (int) state.a_pos_loc < 0     )
     {
 
         printf(
             "vao: %d\n"
             "u_color_loc: %d\n"
             "a_color_loc: %d\n"
-            "a_pos_loc: %d\n"
-            "pos_buff: %d\n", state.vao, state.u_color_loc, state.a_color_loc, state.a_pos_loc, state.pos_buff);
+            "a_pos_loc: %d\n", state.vao, state.u_color_loc, state.a_color_loc, state.a_pos_loc);
 
-        /* die("state.u_color_loc < 0 || state.a_pos_loc < 0 || state.pos_buff < 0"); */
+        /* die("state.u_color_loc < 0 || state.a_pos_loc < 0"); */
     }
     glUniform4f(state.u_color_loc, 0.2, 0.2, 0.2, 1.0);
 
     glEnableVertexAttribArray(state.a_pos_loc);
     glEnableVertexAttribArray(state.a_color_loc);
 
+    //sized for the whole world once, frames only upload what moved
+    if (gfx_stream_init(&state.tris, sizeof(struct vertex) * 3 * world.cap) < 0)
+        die("no vertex buffer");
+
+    //idx, size, type, normalize?, stride, offset
+    glVertexAttribPointer(state.a_pos_loc,   2, GL_FLOAT,         GL_FALSE, 20, (void *) 0);
+
+    /* glVertexAttribPointer(state.a_color_loc, 3, GL_UNSIGNED_BYTE, GL_FALSE, 20, (void *) 16 ); */
+
+    /* VertexAttribIPointer( uint index, int size, enum type, */
+    /* sizei stride, const void *pointer ); */
+    glVertexAttribIPointer(state.a_color_loc, 3, GL_UNSIGNED_BYTE, 20, (void *) 16 );
+}
+
+//buttons come back from scene files by label
+static const struct {
+    const char *label;
+    cb_func cb;
+} button_actions[] = {
+    {"rectangle", cb_rectangle},
+    {"triangle",  cb_triangle},
+};
+
+static void load_scene(const char *path)
+{
+    struct scene sc;
+    uint64_t t0 = SDL_GetPerformanceCounter();
+    if (scene_open(&sc, path) < 0)
+        die("%s: %s", path, sc.last_error);
+    int count = sc.hdr->count;
+    if (state.stream){
+        //everything goes to the backing file, the view pulls it back in
+        if (stream_import(&strm, &sc) < 0)
+            die("%s: %s", path, strm.last_error);
+        phys_set_cell_size(&world, sc.hdr->cell_size);
+        world.floor_y = sc.hdr->floor_y;
+        world.gravity = sc.hdr->gravity;
+    }
+    else if (count > world.cap){
+        float cell = world.cell_size;
+        phys_free(&world);
+        if (phys_init(&world, count + TRI_MAX) < 0)
+            die("phys_init: out of memory");
+        phys_set_cell_size(&world, cell);
+        if (!state.soft){
+            gfx_stream_resize(&state.tris, sizeof(struct vertex) * 3 * world.cap);
+        }
+    }
+    if (!state.stream && scene_load_world(&sc, &world) < 0)
+        die("%s: could not restore the world", path);
+    if (!state.stream && !state.soft){
+        //straight from the mapping, the vertex section is the GL layout
+        gfx_stream_update(&state.tris, 0, sizeof(struct vertex) * 3 * count, sc.vertices);
+        phys_clear_dirty(&world);
+        check_gl(LINEFILESTR);
+    }
+
+    ui_clear(&ui);
+    for (uint32_t i = 0; i < sc.hdr->n_ui; i++){
+        const struct scene_ui *e = &sc.ui[i];
+        char label[sizeof e->text + 1];
+        size_t len = e->textlen < sizeof e->text ? e->textlen : sizeof e->text;
+        memcpy(label, e->text, len);
+        label[len] = '\0';
+        int id = ui_create_button(&ui, e->x, e->y, e->w, e->h, label);
+        if (id < 0)
+            break;
+        struct ui_button *b = (struct ui_button *) &ui.ui_elems[id];
+        memcpy(b->rect.rgb, e->rgb, 4);
+        memcpy(b->text_color, e->text_color, 4);
+        for (size_t j = 0; j < sizeof button_actions / sizeof button_actions[0]; j++)
+            if (strcmp(label, button_actions[j].label) == 0)
+                ui_register_callback(&ui, id, "Lclick", button_actions[j].cb);
+    }
+    scene_close(&sc);
+    LOG_INFO("scene: %d triangles from %s in %.2fms\n", count, path,
+            (SDL_GetPerformanceCounter() - t0) * 1000.0 / SDL_GetPerformanceFrequency());
+}
+
+static void initialize()
+{
+    state.running = 1;
+
+
+    memcpy(state.bg, (float[4]){0.0f, 0.5f, 1.0f, 0.0f}, sizeof(state.bg));
+    state.time.freq = SDL_GetPerformanceFrequency();
+    state.time.last = SDL_GetPerformanceCounter();
+    overlay_init(&state.ov, state.soft ? NULL : &state.gpu);
+    state.z_events  = overlay_add_zone(&state.ov, "events");
+    state.z_physics = overlay_add_zone(&state.ov, "physics");
+    state.z_stream  = state.stream ? overlay_add_zone(&state.ov, "stream") : -1;
+    state.z_draw    = overlay_add_zone(&state.ov, "draw");
+    state.p_tris    = overlay_add_pool(&state.ov, "tris");
+    state.p_ui      = overlay_add_pool(&state.ov, "ui px");
+    srand(state.seed);
+    if (phys_init(&world, TRI_MAX) < 0)
+        die("phys_init: out of memory");
+    camera_init(&state.cam, CAMERA_WORLD, state.w, state.h);
+    state.cam_version = state.cam.version;
+    if (!state.soft)
+        initialize_gl();
+
     push_vec((float [2]) {0.2f, 0.2f});
     push_vec((float [2]) {0.2f, 0.4f});
     push_vec((float [2]) {0.4f, 0.2f});
@@ -468,26 +776,35 @@ static void initialize()
     dump_vertices();
 
 
-    check_gl(LINEFILESTR);
-
-
-    if ( ui_initialize() < 0){
-        die(ui_last_error());
+    if (!state.soft){
+        check_gl(LINEFILESTR);
+        if ( ui_initialize(&ui) < 0){
+            die(ui_last_error(&ui));
+        }
     }
-    ui_set_screen_dim(state.w, state.h);
-    //ui_create_button(int x, int y, int w, int h, const char *label);
-    //ui_register_callback(int element_id, const char *event, cb_func func);
-    int rec = ui_create_button(100, 100, 200, 100, "rectangle");
-    int tri = ui_create_button(310, 100, 200, 100, "triangle");
-    ui_register_callback(tri, "Lclick", cb_triangle);
-    ui_register_callback(rec, "Lclick", cb_rectangle);
+    ui_set_screen_dim(&ui, state.w, state.h);
+    if (state.font_path){
+        if (pfont_open(&state.font, state.font_path) < 0)
+            die("%s", state.font.last_error);
+        if (ui_set_font(&ui, &state.font) < 0)
+            die("%s", ui_last_error(&ui));
+    }
+    //ui_create_button(struct ui *ui, int x, int y, int w, int h, const char *label);
+    //ui_register_callback(struct ui *ui, int element_id, const char *event, cb_func func);
+    int rec = ui_create_button(&ui, 100, 100, 200, 100, "rectangle");
+    int tri = ui_create_button(&ui, 310, 100, 200, 100, "triangle");
+    ui_register_callback(&ui, tri, "Lclick", cb_triangle);
+    ui_register_callback(&ui, rec, "Lclick", cb_rectangle);
     
 }
 
-static void check_sdl(const char *line){
-   const char *m = SDL_GetError(); 
-   if (m){
-        printf( "SDL LAST ERROR: %s\n"
-                "at %s\n", m, line);
-   }
+//fnv-1a over every vertex, equal hashes mean the replay matched
+static uint32_t world_hash(void)
+{
+    const uint8_t *p = (const uint8_t *) world.vertices;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < sizeof(struct vertex) * 3 * world.count; i++)
+        h = (h ^ p[i]) * 16777619u;
+    return h;
 }
+
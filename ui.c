@@ -1,20 +1,15 @@
 #include <stddef.h>
 #include "common.h"
 #include "glad/glad.h"
-#include "font.h"
 #include "checks.h"
+#include "gfx.h"
 #include "ui.h"
-struct ui ui = {0};
+#include "pfont.h"
 
 #define UI_A_POS 0
 #define UI_A_COL 1
-float identity_mat4[16] = { 1.0, 0.0, 0.0, 0.0,
-                            0.0, 1.0, 0.0, 0.0,
-                            0.0, 0.0, 1.0, 0.0,
-                            0.0, 0.0, 0.0, 1.0 };
-float screen_mat4[16] =   { 0 };
 
-int ui_initialize()
+int ui_initialize(struct ui *ui)
 {
 
     const char * vsh_src = 
@@ -36,88 +31,52 @@ int ui_initialize()
         "void main(void){\n"
         "   color = v_color;\n"
         "}\n";
-    ui.prg = glCreateProgram();
-    if( ui.prg < 0){
-        ui.last_error = "prg < -1";
+    if (gfx_program(&ui->prg, vsh_src, fgsh_src, &ui->last_error) < 0)
         return -1;
-    }
-    GLuint vsh = glCreateShader(GL_VERTEX_SHADER);
-    GLuint fgsh = glCreateShader(GL_FRAGMENT_SHADER);
-
-    int vshlen = strlen(vsh_src);
-    int fgshlen = strlen(fgsh_src);
-    glShaderSource(vsh, 1, &vsh_src, &vshlen);
-    glShaderSource(fgsh, 1, &fgsh_src, &fgshlen);
-    glCompileShader(vsh);
-    glCompileShader(fgsh);
-    GLint status;
-    glGetShaderiv(vsh, GL_COMPILE_STATUS, &status);
-    if (status != GL_TRUE){
-        ui.last_error = shader_log(vsh);
-        return -1;
-    }
-    glGetShaderiv(fgsh, GL_COMPILE_STATUS, &status);
-    if (status != GL_TRUE){
-        ui.last_error = shader_log(fgsh);
-        return -1;
-    }
-    glAttachShader(ui.prg, vsh);
-    glAttachShader(ui.prg, fgsh);
-    glDeleteShader(vsh);
-    glDeleteShader(fgsh);
-    glLinkProgram(ui.prg);
-    glGetProgramiv(ui.prg, GL_LINK_STATUS, &status);
-    if (status != GL_TRUE){
-        ui.last_error = "program linking failed";
-        return -1;
-    }
     glFlush();
     
-    glUseProgram(ui.prg);
-    glGenBuffers(1, &ui.vbo);
-    glGenVertexArrays(1, &ui.vao);
+    glUseProgram(ui->prg);
+    glGenBuffers(1, &ui->vbo);
+    glGenVertexArrays(1, &ui->vao);
 
-    glBindVertexArray(ui.vao); 
+    glBindVertexArray(ui->vao); 
 
-    ui.umat_loc = glGetUniformLocation(ui.prg, "u_mat");
+    ui->umat_loc = glGetUniformLocation(ui->prg, "u_mat");
+    camera_init(&ui->cam, CAMERA_SCREEN, ui->screen_width, ui->screen_height);
+    ui->cam_version = ui->cam.version;
 
     glEnableVertexAttribArray(UI_A_POS);
     glEnableVertexAttribArray(UI_A_COL);
-    glEnableVertexAttribArray(ui.umat_loc);
+    glEnableVertexAttribArray(ui->umat_loc);
 
 
     /* check_gl(LINEFILESTR); */
     return 0;
 }
 
-void ui_gl_restore_state(){
-    glUseProgram(ui.prg);
-    glBindVertexArray(ui.vao);
-    glBindBuffer(GL_ARRAY_BUFFER, ui.vbo);
+static void gl_restore_state(struct ui *ui){
+    glUseProgram(ui->prg);
+    glBindVertexArray(ui->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, ui->vbo);
     glVertexAttribIPointer(UI_A_POS, 2, GL_UNSIGNED_SHORT,  sizeof(uvec2), (void *) offsetof(uvec2, x));
     glVertexAttribIPointer(UI_A_COL, 4, GL_UNSIGNED_BYTE, sizeof(uvec2), (void *) offsetof(uvec2, rgb));
-    if (ui.screen_width < 1.0 || ui.screen_height < 1.0){ //instead of dividing by 0
-        ui.last_error = "invalid screen size";
-        memcpy(screen_mat4, identity_mat4, sizeof screen_mat4);
+    if (ui->screen_width < 1 || ui->screen_height < 1) //camera falls back to identity
+        ui->last_error = "invalid screen size";
+    //the uniform lives in the program, only upload it when the camera changed
+    float *m = camera_matrix(&ui->cam);
+    if (ui->cam.version != ui->cam_version){
+        ui->cam_version = ui->cam.version;
+        glUniformMatrix4fv(ui->umat_loc, 1, GL_FALSE, m);
     }
-    else{
-#define m screen_mat4
-                                //scale                                    //translate
-        m[0 ] = 1.0 / (ui.screen_width / 2.0); m[1] = 0.0;   m[2 ] = 0.0; m[3 ] = -1.0;
-        m[4 ] = 0.0; m[5 ] = -1.0 / (ui.screen_height / 2.0); m[6 ] = 0.0; m[7 ] =  1.0;
-        m[8 ] = 0.0; m[9 ] =  0.0;                            m[10] = 1.0; m[11] =  0.0;
-        m[12] = 0.0; m[13] =  0.0;                            m[14] = 0.0; m[15] =  1.0;
-#undef m
-    }
-    glUniformMatrix4fv(ui.umat_loc, 1, GL_TRUE, screen_mat4);
     check_gl(LINEFILESTR);
 }
 
-void ui_set_screen_dim(uint16_t w, uint16_t h)
+void ui_set_screen_dim(struct ui *ui, uint16_t w, uint16_t h)
 {
-    ui.cached = false;
-    ui.screen_width = w;
-    ui.screen_height = h;
+    ui->cached = false;
+    ui->screen_width = w;
+    ui->screen_height = h;
+    camera_set_viewport(&ui->cam, w, h);
 }
 
 static void set_color(uint8_t rgb[4], uint32_t color)
@@ -131,159 +90,751 @@ static void set_color(uint8_t rgb[4], uint32_t color)
     rgb[0] = (color & ((int32_t) 0xFF << 24)) >> 24;
 }
 
-int ui_put_pixel_rgb_array(uint16_t x, uint16_t y, uint8_t rgb[4])
+enum clip_result{
+    CLIP_OUT,
+    CLIP_IN,
+    CLIP_PART,
+};
+
+static struct ui_clip clip_top(const struct ui *ui)
+{
+    if (ui->n_clips)
+        return ui->clips[ui->n_clips - 1];
+    return (struct ui_clip){0, 0, ui->screen_width, ui->screen_height};
+}
+
+//where [x, x + w) x [y, y + h) is relative to the current clip
+static enum clip_result clip_test(const struct ui *ui, int x, int y, int w, int h)
+{
+    struct ui_clip c = clip_top(ui);
+    if (w <= 0 || h <= 0 || x >= c.x1 || y >= c.y1 || x + w <= c.x0 || y + h <= c.y0)
+        return CLIP_OUT;
+    if (x >= c.x0 && y >= c.y0 && x + w <= c.x1 && y + h <= c.y1)
+        return CLIP_IN;
+    return CLIP_PART;
+}
+
+static int clip_contains(const struct ui_clip *c, int x, int y)
+{
+    return x >= c->x0 && x < c->x1 && y >= c->y0 && y < c->y1;
+}
+
+static int clip_point(const struct ui *ui, int x, int y)
+{
+    struct ui_clip c = clip_top(ui);
+    return clip_contains(&c, x, y);
+}
+
+//drops the pixels from first on that are outside the clip
+static void clip_pixels(struct ui *ui, int first)
+{
+    int n = first;
+    for (int i = first; i < ui->n_pixels; i++){
+        uvec2 p = ui->data.pixels[i];
+        if (clip_point(ui, p.x, p.y))
+            ui->data.pixels[n++] = p;
+    }
+    ui->n_pixels = n;
+}
+
+int ui_push_clip(struct ui *ui, int x, int y, int w, int h)
 {
-    ui.cached = 0;
-    if(ui.n_pixels >= PIX_MAX)
+    if (ui->n_clips >= UI_CLIP_MAX){
+        ui->last_error = "too many nested clips";
         return -1;
-    ui.data.pixels[ui.n_pixels].x = x;
-    ui.data.pixels[ui.n_pixels].y = y;
-    memcpy(ui.data.pixels[ui.n_pixels].rgb, rgb, sizeof(uint8_t[4]));
-    return ui.n_pixels++;
+    }
+    struct ui_clip c = clip_top(ui);
+    struct ui_clip *n = &ui->clips[ui->n_clips++];
+    n->x0 = x > c.x0 ? x : c.x0;
+    n->y0 = y > c.y0 ? y : c.y0;
+    n->x1 = x + w < c.x1 ? x + w : c.x1;
+    n->y1 = y + h < c.y1 ? y + h : c.y1;
+    //empty clips everything
+    if (n->x1 < n->x0)
+        n->x1 = n->x0;
+    if (n->y1 < n->y0)
+        n->y1 = n->y0;
+    return 0;
+}
+
+int ui_pop_clip(struct ui *ui)
+{
+    if (!ui->n_clips){
+        ui->last_error = "ui_pop_clip() without ui_push_clip()";
+        return -1;
+    }
+    ui->n_clips--;
+    return 0;
+}
+
+int ui_put_pixel_rgb_array(struct ui *ui, uint16_t x, uint16_t y, uint8_t rgb[4])
+{
+    ui->cached = 0;
+    if (!clip_point(ui, x, y))
+        return 0;
+    if(ui->n_pixels >= PIX_MAX)
+        return -1;
+    ui->data.pixels[ui->n_pixels].x = x;
+    ui->data.pixels[ui->n_pixels].y = y;
+    memcpy(ui->data.pixels[ui->n_pixels].rgb, rgb, sizeof(uint8_t[4]));
+    return ui->n_pixels++;
 }
 
-static int ui_put_vertex_rgb_array(uint16_t x, uint16_t y, uint8_t rgb[4])
+static int ui_put_vertex_rgb_array(struct ui *ui, uint16_t x, uint16_t y, uint8_t rgb[4])
 {
-    ui.cached = 0;
-    if(ui.n_vertices >= PIX_MAX)
+    ui->cached = 0;
+    if(ui->n_vertices >= PIX_MAX)
         return -1;
-    ui.data.vertices[ui.n_vertices].x = x;
-    ui.data.vertices[ui.n_vertices].y = y;
-    memcpy(ui.data.vertices[ui.n_vertices].rgb, rgb, sizeof(uint8_t[4]));
-    return ui.n_vertices++;
+    ui->data.vertices[ui->n_vertices].x = x;
+    ui->data.vertices[ui->n_vertices].y = y;
+    memcpy(ui->data.vertices[ui->n_vertices].rgb, rgb, sizeof(uint8_t[4]));
+    return ui->n_vertices++;
 }
 
-int ui_put_pixel(uint16_t x, uint16_t y, uint32_t color)
+int ui_put_pixel(struct ui *ui, uint16_t x, uint16_t y, uint32_t color)
 {
-    ui.cached = 0;
-    if(ui.n_pixels >= PIX_MAX)
+    ui->cached = 0;
+    if (!clip_point(ui, x, y))
+        return 0;
+    if(ui->n_pixels >= PIX_MAX)
         return -1;
-    ui.data.pixels[ui.n_pixels].x = x;
-    ui.data.pixels[ui.n_pixels].y = y;
-    set_color(ui.data.pixels[ui.n_pixels].rgb, color);
-    return ui.n_pixels++;
+    ui->data.pixels[ui->n_pixels].x = x;
+    ui->data.pixels[ui->n_pixels].y = y;
+    set_color(ui->data.pixels[ui->n_pixels].rgb, color);
+    return ui->n_pixels++;
 }
 
-int ui_put_rect(urect *rect)
+//bulk ui_put_pixel, for callers that keep rasterized pixels around
+int ui_put_pixels(struct ui *ui, const uvec2 *px, int n)
 {
-    ui.cached = 0;
-    if (ui.n_rects >= RECT_MAX)
+    ui->cached = 0;
+    if (n > PIX_MAX - ui->n_pixels)
         return -1;
-    memcpy(ui.data.rects + ui.n_rects, rect, sizeof(urect));
-    return ui.n_rects++;
+    int first = ui->n_pixels;
+    memcpy(ui->data.pixels + ui->n_pixels, px, sizeof(uvec2) * n);
+    ui->n_pixels += n;
+    clip_pixels(ui, first);
+    return 0;
 }
 
-int ui_draw_text(uint16_t x, uint16_t y, const char *text, uint8_t rgb[4])
+int ui_put_rect(struct ui *ui, urect *rect)
 {
-    if (!text || y > ui.screen_height || y < 0 || x > ui.screen_height || x < 0 || !rgb){
-        ui.last_error = "invalid parameter to ui_draw_text()";
+    ui->cached = 0;
+    enum clip_result vis = clip_test(ui, rect->x, rect->y, rect->w, rect->h);
+    if (vis == CLIP_OUT)
+        return 0;
+    if (ui->n_rects >= RECT_MAX)
         return -1;
+    urect *r = ui->data.rects + ui->n_rects;
+    memcpy(r, rect, sizeof(urect));
+    if (vis == CLIP_PART){
+        struct ui_clip c = clip_top(ui);
+        int x1 = r->x + r->w < c.x1 ? r->x + r->w : c.x1;
+        int y1 = r->y + r->h < c.y1 ? r->y + r->h : c.y1;
+        r->x = r->x > c.x0 ? r->x : c.x0;
+        r->y = r->y > c.y0 ? r->y : c.y0;
+        r->w = x1 - r->x;
+        r->h = y1 - r->y;
     }
+    return ui->n_rects++;
+}
+
+_Static_assert(sizeof(uvec2) == sizeof(uint64_t), "uvec2 is added as one 64 bit word");
+
+//a pixel is x + dx, y + dy with no lane overflowing, so one 64 bit add of
+//the uvec2 bits does x, y and the color at once
+static uint64_t pack_px(uint16_t x, uint16_t y, const uint8_t rgb[4])
+{
+    uvec2 p = {x, y, {rgb[0], rgb[1], rgb[2], rgb[3]}};
+    uint64_t bits;
+    memcpy(&bits, &p, sizeof bits);
+    return bits;
+}
 
-    y += 13;
+static void text_cache_clear(struct ui_text_cache *c)
+{
+    memset(c->slots, 0, sizeof c->slots);
+    c->n = c->n_glyphs = c->n_blob = 0;
+    c->stats.flushes++;
+}
+
+int ui_set_font(struct ui *ui, const struct pfont *font)
+{
+    struct ui_glyph_px *g = malloc(sizeof *g * font->hdr->n_glyphs);
+    if (!g){
+        ui->last_error = "out of memory";
+        return -1;
+    }
+    for (uint32_t i = 0; i < font->hdr->n_glyphs; i++)
+        g[i].at = UI_GLYPH_UNSET;
+    free(ui->font.glyphs);
+    ui->font.glyphs = g;
+    ui->font.src = font;
+    ui->font.n_px = 0;
+    text_cache_clear(&ui->text);
+    sdf_free(&ui->sdf);
+    ui->sdf_gl.uploaded = 0;
+    return 0;
+}
+
+static int use_font(struct ui *ui)
+{
+    if (ui->font.src)
+        return 0;
+    const struct pfont *f = pfont_builtin();
+    if (!f){
+        ui->last_error = "no builtin font";
+        return -1;
+    }
+    return ui_set_font(ui, f);
+}
+
+//same pixel order the RASTERS bits were always tested in: bottom row first,
+//right to left
+static int expand_glyph(struct ui *ui, int g)
+{
+    static const uint8_t none[4];
+    struct ui_font *f = &ui->font;
+    const struct pfont_glyph *pg = &f->src->glyphs[g];
+    size_t need = f->n_px + pg->w * pg->h;
+    if (need > f->cap_px){
+        size_t cap = f->cap_px ? f->cap_px * 2 : 4096;
+        while (cap < need)
+            cap *= 2;
+        uint64_t *px = realloc(f->px, sizeof *px * cap);
+        if (!px){
+            ui->last_error = "out of memory";
+            return -1;
+        }
+        f->px = px;
+        f->cap_px = cap;
+    }
+    const uint8_t *bits = f->src->bits + pg->bits;
+    int stride = (pg->w + 7) / 8;
+    uint32_t n = 0;
+    for (int row = pg->h - 1; row >= 0; row--)
+        for (int col = pg->w - 1; col >= 0; col--)
+            if (bits[row * stride + col / 8] >> (7 - col % 8) & 1U)
+                f->px[f->n_px + n++] = pack_px(pg->x + col, pg->y + row, none);
+    f->glyphs[g] = (struct ui_glyph_px){f->n_px, n};
+    f->n_px += n;
+    return 0;
+}
+
+static inline uint32_t next_cp(const char **s)
+{
+    unsigned char c = **s;
+    return c < 0x80 ? (*s)++, c : pfont_utf8_next(s);
+}
+
+//glyph of the codepoint at *s, moves *s past it. -1 when its pixels can't
+//be expanded
+static inline int next_glyph(struct ui *ui, const char **s)
+{
+    int g = pfont_glyph(ui->font.src, next_cp(s));
+    if (ui->font.glyphs[g].at == UI_GLYPH_UNSET && expand_glyph(ui, g) < 0)
+        return -1;
+    return g;
+}
+
+uint16_t ui_measure_text(struct ui *ui, const char *text)
+{
+    if (use_font(ui) < 0)
+        return 0;
+    const struct pfont *f = ui->font.src;
+    size_t w = 0;
+    while (*text)
+        w += f->glyphs[pfont_glyph(f, next_cp(&text))].advance;
+    return w < UINT16_MAX ? w : UINT16_MAX;
+}
+
+//pixels of text starting at base into dst, -1 when they would pass cap
+static int rasterize(struct ui *ui, const char *text, uint64_t base, uvec2 *dst, int cap)
+{
+    static const uint8_t none[4];
+    const struct ui_font *f = &ui->font;
+    int n = 0;
     while (*text){
-        char t = *text;
-        char pixrow;
-        if (t >= 32 && t < 127){
-            for (int i=0; i<13; i++){ //row
-                pixrow = RASTERS[t-32][i];
-                for(int j=7; j>=0; j--){ //column
-                    if (pixrow & 1U)
-                        ui_put_pixel_rgb_array(x+j, y-i, rgb);
-                    pixrow = pixrow >> 1;
-                }
+        int g = next_glyph(ui, &text);
+        if (g < 0)
+            return -1;
+        const uint64_t *src = f->px + f->glyphs[g].at;
+        int count = f->glyphs[g].n;
+        if (count > cap - n){
+            ui->last_error = "ui pixels full";
+            return -1;
+        }
+        for (int i = 0; i < count; i++){
+            uint64_t p = src[i] + base;
+            memcpy(dst + n + i, &p, sizeof p);
+        }
+        n += count;
+        base += pack_px(f->src->glyphs[g].advance, 0, none);
+    }
+    return n;
+}
+
+static int check_pos(struct ui *ui, uint16_t x, uint16_t y, uint16_t width)
+{
+    //the lanes of the packed pixels must not overflow
+    int extent = ui->font.src->extent;
+    if (x > UINT16_MAX - width - extent || y > UINT16_MAX - extent){
+        ui->last_error = "text past the 16 bit coordinate range";
+        return -1;
+    }
+    return 0;
+}
+
+//glyphs can reach extent past the advance and below the line top
+static enum clip_result clip_text(struct ui *ui, uint16_t x, uint16_t y, uint16_t width)
+{
+    int extent = ui->font.src->extent;
+    return clip_test(ui, x, y, width + extent, extent);
+}
+
+//-1 on bad arguments, otherwise where the text is relative to the clip
+static int check_text(struct ui *ui, uint16_t x, uint16_t y, const char *text, uint8_t rgb[4])
+{
+    if (!text || !rgb){
+        ui->last_error = "invalid parameter to ui_draw_text()";
+        return -1;
+    }
+    if (use_font(ui) < 0)
+        return -1;
+    //rows above or below the clip go before measuring, for long lists
+    if (clip_text(ui, x, y, UINT16_MAX) == CLIP_OUT)
+        return CLIP_OUT;
+    uint16_t width = ui_measure_text(ui, text);
+    if (check_pos(ui, x, y, width) < 0)
+        return -1;
+    return clip_text(ui, x, y, width);
+}
+
+int ui_draw_text(struct ui *ui, uint16_t x, uint16_t y, const char *text, uint8_t rgb[4])
+{
+    int vis = check_text(ui, x, y, text, rgb);
+    if (vis <= 0)
+        return vis;
+    ui->cached = 0;
+    int n = rasterize(ui, text, pack_px(x, y, rgb), ui->data.pixels + ui->n_pixels,
+                      PIX_MAX - ui->n_pixels);
+    if (n < 0)
+        return -1;
+    ui->n_pixels += n;
+    if (vis == CLIP_PART)
+        clip_pixels(ui, ui->n_pixels - n);
+    return 0;
+}
+
+static void put_quad_vertex(struct ui_quad_vertex *v, float x, float y, float u, float t, const uint8_t rgb[4])
+{
+    *v = (struct ui_quad_vertex){x, y, u, t, {rgb[0], rgb[1], rgb[2], rgb[3]}};
+}
+
+int ui_draw_text_scaled(struct ui *ui, uint16_t x, uint16_t y, float scale, const char *text, uint8_t rgb[4])
+{
+    if (!text || !rgb || !(scale > 0)){
+        ui->last_error = "invalid parameter to ui_draw_text_scaled()";
+        return -1;
+    }
+    if (use_font(ui) < 0)
+        return -1;
+    if (!ui->sdf.texels && sdf_build(&ui->sdf, ui->font.src) < 0){
+        ui->last_error = ui->sdf.last_error;
+        return -1;
+    }
+    const struct pfont *f = ui->font.src;
+    struct ui_clip clip = clip_top(ui);
+    float pen = x, k = scale / SDF_SCALE; //screen pixels per texel
+    //no glyph starts left of its pen by more than the padding
+    while (*text && pen - SDF_PAD * k < clip.x1){
+        int g = pfont_glyph(f, next_cp(&text));
+        const struct pfont_glyph *pg = &f->glyphs[g];
+        const struct sdf_cell *c = &ui->sdf.cells[g];
+        float x0 = pen + (pg->x * SDF_SCALE - SDF_PAD) * k, x1 = x0 + c->w * k;
+        float y0 = y + (pg->y * SDF_SCALE - SDF_PAD) * k, y1 = y0 + c->h * k;
+        pen += pg->advance * scale;
+        //cut to the clip, the texture coordinates move along
+        float u0 = c->x, u1 = c->x + c->w, v0 = c->y, v1 = c->y + c->h;
+        if (x0 < clip.x0){
+            u0 += (clip.x0 - x0) / k;
+            x0 = clip.x0;
+        }
+        if (x1 > clip.x1){
+            u1 -= (x1 - clip.x1) / k;
+            x1 = clip.x1;
+        }
+        if (y0 < clip.y0){
+            v0 += (clip.y0 - y0) / k;
+            y0 = clip.y0;
+        }
+        if (y1 > clip.y1){
+            v1 -= (y1 - clip.y1) / k;
+            y1 = clip.y1;
+        }
+        if (c->w && x0 < x1 && y0 < y1){
+            if (ui->n_quads == UI_QUAD_MAX){
+                ui->last_error = "ui quads full";
+                return -1;
             }
+            struct ui_quad_vertex *v = ui->data.quads + ui->n_quads * 6;
+            //same winding as the rects
+            put_quad_vertex(v + 0, x0, y0, u0, v0, rgb);
+            put_quad_vertex(v + 1, x0, y1, u0, v1, rgb);
+            put_quad_vertex(v + 2, x1, y0, u1, v0, rgb);
+            put_quad_vertex(v + 3, x0, y1, u0, v1, rgb);
+            put_quad_vertex(v + 4, x1, y1, u1, v1, rgb);
+            put_quad_vertex(v + 5, x1, y0, u1, v0, rgb);
+            ui->n_quads++;
+        }
+    }
+    return 0;
+}
+
+static uint32_t hash_text(const char *text, int len, const struct pfont *font)
+{
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < len; i++)
+        h = (h ^ (uint8_t) text[i]) * 16777619u;
+    return (h ^ (uint32_t) (uintptr_t) font) * 16777619u;
+}
+
+//glyphs of text into dst, -1 when they would pass cap
+static int layout(struct ui *ui, const char *text, struct ui_glyph_pos *dst, int cap, int *n_pixels)
+{
+    const struct ui_font *f = &ui->font;
+    int n = 0, x = 0;
+    *n_pixels = 0;
+    while (*text){
+        int g = next_glyph(ui, &text);
+        if (g < 0 || x > UINT16_MAX)
+            return -1;
+        int at = x;
+        x += f->src->glyphs[g].advance;
+        if (!f->glyphs[g].n)
+            continue; //blank, nothing to replay
+        if (n == cap)
+            return -1;
+        dst[n++] = (struct ui_glyph_pos){g, at};
+        *n_pixels += f->glyphs[g].n;
+    }
+    return n;
+}
+
+//the layout of text, made on first use. NULL when it can't be cached, the
+//text is then too big for the cache
+static const struct ui_text *text_get(struct ui *ui, const char *text)
+{
+    struct ui_text_cache *c = &ui->text;
+    int len = strlen(text);
+    uint32_t h = hash_text(text, len, ui->font.src);
+    unsigned i = h & (UI_TEXT_SLOTS - 1);
+    for (; c->slots[i].used; i = (i + 1) & (UI_TEXT_SLOTS - 1)){
+        struct ui_text *t = &c->slots[i];
+        if (t->hash == h && t->len == len && t->font == ui->font.src &&
+            memcmp(c->blob + t->key, text, len) == 0){
+            c->stats.hits++;
+            return t;
+        }
+    }
+    c->stats.misses++;
+    if (len >= UI_TEXT_BLOB)
+        return NULL;
+
+    //full: start over, the labels still in use come back on the next rebuild
+    int n = -1, n_pixels;
+    for (int pass = 0; pass < 2 && n < 0; pass++){
+        if (pass || c->n >= UI_TEXT_SLOTS * 3 / 4 || len > UI_TEXT_BLOB - c->n_blob){
+            if (!c->n)
+                return NULL;
+            text_cache_clear(c);
+            i = h & (UI_TEXT_SLOTS - 1);
+        }
+        n = layout(ui, text, c->glyphs + c->n_glyphs, UI_TEXT_GLYPHS - c->n_glyphs, &n_pixels);
+    }
+    if (n < 0)
+        return NULL;
+    struct ui_text *t = &c->slots[i];
+    *t = (struct ui_text){
+        .used = 1, .hash = h, .font = ui->font.src, .len = len,
+        .key = c->n_blob, .first = c->n_glyphs, .count = n, .n_pixels = n_pixels,
+        .width = ui_measure_text(ui, text), .height = ui->font.src->hdr->height,
+    };
+    memcpy(c->blob + c->n_blob, text, len);
+    c->n_blob += len;
+    c->n_glyphs += n;
+    c->n++;
+    return t;
+}
+
+//expands the glyphs from the font table, no per character work left
+static int put_text(struct ui *ui, const struct ui_text *t, uint16_t x, uint16_t y, const uint8_t rgb[4])
+{
+    enum clip_result vis = clip_text(ui, x, y, t->width);
+    if (vis == CLIP_OUT)
+        return 0;
+    if (t->n_pixels > PIX_MAX - ui->n_pixels){
+        ui->last_error = "ui pixels full";
+        return -1;
+    }
+    ui->cached = 0;
+    static const uint8_t none[4];
+    const struct ui_font *f = &ui->font;
+    const struct ui_glyph_pos *g = ui->text.glyphs + t->first;
+    uint64_t base = pack_px(x, y, rgb);
+    uvec2 *dst = ui->data.pixels + ui->n_pixels;
+    for (int k = 0; k < t->count; k++){
+        const uint64_t *src = f->px + f->glyphs[g[k].glyph].at;
+        int count = f->glyphs[g[k].glyph].n;
+        uint64_t at = base + pack_px(g[k].x, 0, none);
+        for (int i = 0; i < count; i++){
+            uint64_t p = src[i] + at;
+            memcpy(dst + i, &p, sizeof p);
         }
-        x += 8 + RASTERS_SPACING;
-        text++;
+        dst += count;
     }
+    ui->n_pixels += t->n_pixels;
+    if (vis == CLIP_PART)
+        clip_pixels(ui, ui->n_pixels - t->n_pixels);
     return 0;
 }
+
+int ui_draw_label(struct ui *ui, uint16_t x, uint16_t y, const char *text, uint8_t rgb[4])
+{
+    int vis = check_text(ui, x, y, text, rgb);
+    if (vis <= 0)
+        return vis;
+    const struct ui_text *t = text_get(ui, text);
+    if (!t)
+        return ui_draw_text(ui, x, y, text, rgb);
+    return put_text(ui, t, x, y, rgb);
+}
+
 uint16_t ui_textwidth(int len){
-    return len * 8.0 + len * RASTERS_SPACING;
+    const struct pfont *f = pfont_builtin();
+    return f ? len * f->glyphs[0].advance : 0;
 }
 uint16_t ui_textheight(int len){
     return 13;
 }
-inline static void draw_button(int button_id)
+//the button keeps its layout, only a cache flush looks it up again
+static const struct ui_text *button_text(struct ui *ui, struct ui_button *b)
+{
+    if (b->layout && b->layout_gen == ui->text.stats.flushes)
+        return b->layout;
+    b->layout = text_get(ui, b->text);
+    b->layout_gen = ui->text.stats.flushes;
+    return b->layout;
+}
+
+inline static void draw_button(struct ui *ui, int button_id)
 {
-    struct ui_button *button = (struct ui_button*) &ui.ui_elems[button_id];
-    ui_put_rect(&button->rect);
-    if (!button->text)
+    struct ui_button *button = (struct ui_button*) &ui->ui_elems[button_id];
+    urect *r = &button->rect;
+    if (clip_test(ui, r->x, r->y, r->w, r->h) == CLIP_OUT)
+        return;
+    ui_put_rect(ui, r);
+    if (!button->text || use_font(ui) < 0)
         return;
+    //centred on the measured width, the label itself is laid out once
+    const struct ui_text *t = button_text(ui, button);
+    uint16_t w = t ? t->width : ui_measure_text(ui, button->text);
     uint16_t sx, sy;
-    sx = button->rect.x +button->rect.w / 2 - ui_textwidth(button->textlen) / 2;
-    sy = button->rect.y +button->rect.h / 2 - ui_textheight(button->textlen) / 2;
-    ui_draw_text(sx, sy, button->text, button->text_color);
+    sx = button->rect.x +button->rect.w / 2 - w / 2;
+    sy = button->rect.y +button->rect.h / 2 - ui->font.src->hdr->height / 2;
+    if (!t)
+        ui_draw_text(ui, sx, sy, button->text, button->text_color);
+    else if (check_pos(ui, sx, sy, w) == 0)
+        put_text(ui, t, sx, sy, button->text_color);
 }
 //adds a null terminator
-static char *copy_to_blob(const char *str, int len)
+static char *copy_to_blob(struct ui *ui, const char *str, int len)
 {
-    if (ui.bloblen + len + 1 >= STR_BLOB_MAX)
+    if (ui->bloblen + len + 1 >= STR_BLOB_MAX)
         return NULL;
-    char *at = ui.data.strblob + ui.bloblen;
+    char *at = ui->data.strblob + ui->bloblen;
     memcpy(at, str, len);
     at[len] = '\0';
-    ui.bloblen += len + 1;
+    ui->bloblen += len + 1;
     return at;
 }
 
-int ui_render()
+#define SDF_A_POS 0
+#define SDF_A_UV  1
+#define SDF_A_COL 2
+
+static int sdf_gl_init(struct ui *ui)
 {
+    const char *vsh_src =
+        "#version 330\n"
+        "layout(location = 0) in vec2 a_pos;\n"
+        "layout(location = 1) in vec2 a_uv;\n"
+        "layout(location = 2) in vec4 a_color;\n"
+        "uniform mat4 u_mat;\n"
+        "uniform vec2 u_atlas;\n"
+        "out vec2 v_uv;\n"
+        "out vec4 v_color;\n"
+        "void main(void){\n"
+        "   gl_Position = u_mat * vec4(a_pos, 1.0, 1.0);\n"
+        "   v_uv = a_uv / u_atlas;\n"
+        "   v_color = a_color;\n"
+        "}\n";
+    //the edge is at 0.5, smoothed over about a screen pixel at any scale
+    const char *fsh_src =
+        "#version 330\n"
+        "in vec2 v_uv;\n"
+        "in vec4 v_color;\n"
+        "out vec4 color;\n"
+        "uniform sampler2D u_sdf;\n"
+        "void main(void){\n"
+        "   float d = texture(u_sdf, v_uv).r;\n"
+        "   float w = max(fwidth(d) * 0.5, 1.0 / 255.0);\n"
+        "   color = vec4(v_color.rgb, v_color.a * smoothstep(0.5 - w, 0.5 + w, d));\n"
+        "}\n";
+    if (gfx_program(&ui->sdf_gl.prg, vsh_src, fsh_src, &ui->last_error) < 0)
+        return -1;
+    glUseProgram(ui->sdf_gl.prg);
+    ui->sdf_gl.umat_loc = glGetUniformLocation(ui->sdf_gl.prg, "u_mat");
+    ui->sdf_gl.uatlas_loc = glGetUniformLocation(ui->sdf_gl.prg, "u_atlas");
+    glUniform1i(glGetUniformLocation(ui->sdf_gl.prg, "u_sdf"), 0);
+    ui->sdf_gl.cam_version = ui->cam.version - 1;
+
+    glGenVertexArrays(1, &ui->sdf_gl.vao);
+    glGenBuffers(1, &ui->sdf_gl.vbo);
+    glBindVertexArray(ui->sdf_gl.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, ui->sdf_gl.vbo);
+    glEnableVertexAttribArray(SDF_A_POS);
+    glEnableVertexAttribArray(SDF_A_UV);
+    glEnableVertexAttribArray(SDF_A_COL);
+    glVertexAttribPointer(SDF_A_POS, 2, GL_FLOAT, GL_FALSE, sizeof(struct ui_quad_vertex),
+                          (void *) offsetof(struct ui_quad_vertex, x));
+    glVertexAttribPointer(SDF_A_UV, 2, GL_FLOAT, GL_FALSE, sizeof(struct ui_quad_vertex),
+                          (void *) offsetof(struct ui_quad_vertex, u));
+    glVertexAttribPointer(SDF_A_COL, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(struct ui_quad_vertex),
+                          (void *) offsetof(struct ui_quad_vertex, rgb));
+
+    glGenTextures(1, &ui->sdf_gl.tex);
+    glBindTexture(GL_TEXTURE_2D, ui->sdf_gl.tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    check_gl(LINEFILESTR);
+    return 0;
+}
 
-    //fix TODO
-    glBufferData(GL_ARRAY_BUFFER, sizeof(uvec2) * ui.n_vertices, ui.data.vertices, GL_STATIC_DRAW);
-    int n_points = ui.n_vertices - ui.first_point_vertex;
-    glDrawArrays(GL_TRIANGLES, 0, ui.first_point_vertex);
-    glDrawArrays(GL_POINTS, ui.first_point_vertex, n_points);
+//blended, after the points. leaves its own program and vao bound
+static int draw_quads(struct ui *ui)
+{
+    if (!ui->sdf_gl.prg && sdf_gl_init(ui) < 0)
+        return -1;
+    glUseProgram(ui->sdf_gl.prg);
+    glBindVertexArray(ui->sdf_gl.vao);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, ui->sdf_gl.tex);
+    if (!ui->sdf_gl.uploaded){
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ui->sdf.w, ui->sdf.h, 0, GL_RED, GL_UNSIGNED_BYTE,
+                     ui->sdf.texels);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glUniform2f(ui->sdf_gl.uatlas_loc, ui->sdf.w, ui->sdf.h);
+        ui->upload_bytes += (size_t) ui->sdf.w * ui->sdf.h;
+        ui->sdf_gl.uploaded = 1;
+    }
+    if (ui->cam.version != ui->sdf_gl.cam_version){
+        ui->sdf_gl.cam_version = ui->cam.version;
+        glUniformMatrix4fv(ui->sdf_gl.umat_loc, 1, GL_FALSE, camera_matrix(&ui->cam));
+    }
+    size_t bytes = sizeof(struct ui_quad_vertex) * 6 * ui->n_quads;
+    glBindBuffer(GL_ARRAY_BUFFER, ui->sdf_gl.vbo);
+    glBufferData(GL_ARRAY_BUFFER, bytes, ui->data.quads, GL_STREAM_DRAW);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArrays(GL_TRIANGLES, 0, 6 * ui->n_quads);
+    glDisable(GL_BLEND);
+    ui->draw_calls++;
+    ui->upload_bytes += bytes;
+    return 0;
+}
+
+static int ui_render(struct ui *ui)
+{
 
+    //fix TODO
+    glBufferData(GL_ARRAY_BUFFER, sizeof(uvec2) * ui->n_vertices, ui->data.vertices, GL_STATIC_DRAW);
+    int n_points = ui->n_vertices - ui->first_point_vertex;
+    glDrawArrays(GL_TRIANGLES, 0, ui->first_point_vertex);
+    glDrawArrays(GL_POINTS, ui->first_point_vertex, n_points);
+    ui->draw_calls = 2;
+    ui->upload_bytes = sizeof(uvec2) * ui->n_vertices;
+    if (ui->n_quads)
+        return draw_quads(ui);
     return 0;
 }
 
-int ui_display(void)
+//builds ui->data.vertices without touching GL, rects first then points
+int ui_build(struct ui *ui)
 {
-    ui_gl_restore_state();
-    check_gl(LINEFILESTR);
-    if (ui.cached)
-        return ui_render();
-    ui.n_vertices = 0;
-
-    for (int i=0; i<ui.n_ui; i++){
-        switch(ui.ui_elems[i].head.type){
-            case UI_BUTTON:
-                draw_button(i);
+    if (ui->cached)
+        return 0;
+    ui->n_vertices = 0;
+
+    //each button goes in as the only clip on the stack, its own
+    int n_clips = ui->n_clips;
+    struct ui_clip bottom = ui->clips[0];
+    for (int i=0; i<ui->n_ui; i++){
+        switch(ui->ui_elems[i].head.type){
+            case UI_BUTTON: {
+                struct ui_button *b = (struct ui_button *) &ui->ui_elems[i];
+                ui->clips[0] = b->clip;
+                ui->n_clips = b->clipped;
+                draw_button(ui, i);
+            }
             break;
             default:
-                ui.last_error = "unknown ui element type.";
+                ui->n_clips = n_clips;
+                ui->clips[0] = bottom;
+                ui->last_error = "unknown ui element type.";
                 return -1;
             break;
         }
     }
+    ui->n_clips = n_clips;
+    ui->clips[0] = bottom;
 
     //rects -> pixels
-    for (int i=0; i<ui.n_rects; i++){
+    for (int i=0; i<ui->n_rects; i++){
         //emit 6 vertices per rectangle
         //using put pixel even though it will not be drawn as a pixel!
-        urect *r = &ui.data.rects[i];
+        urect *r = &ui->data.rects[i];
         //     w
         // (1)     (2)
         //              h
         // (3)     (4)
         // 1, 3, 2, 3, 4, 2
-        ui_put_vertex_rgb_array(r->x,      r->y,      r->rgb);
-        ui_put_vertex_rgb_array(r->x,      r->y+r->h, r->rgb);
-        ui_put_vertex_rgb_array(r->x+r->w, r->y,      r->rgb);
-        ui_put_vertex_rgb_array(r->x,      r->y+r->h, r->rgb);
-        ui_put_vertex_rgb_array(r->x+r->w, r->y+r->h, r->rgb);
-        ui_put_vertex_rgb_array(r->x+r->w, r->y,      r->rgb);
+        ui_put_vertex_rgb_array(ui, r->x,      r->y,      r->rgb);
+        ui_put_vertex_rgb_array(ui, r->x,      r->y+r->h, r->rgb);
+        ui_put_vertex_rgb_array(ui, r->x+r->w, r->y,      r->rgb);
+        ui_put_vertex_rgb_array(ui, r->x,      r->y+r->h, r->rgb);
+        ui_put_vertex_rgb_array(ui, r->x+r->w, r->y+r->h, r->rgb);
+        ui_put_vertex_rgb_array(ui, r->x+r->w, r->y,      r->rgb);
 
     }
-    ui.first_point_vertex = ui.n_vertices;
+    ui->first_point_vertex = ui->n_vertices;
     //CHECK IF THERE IS SPACE
-    memcpy(ui.data.vertices + ui.n_vertices, ui.data.pixels, ui.n_pixels * sizeof(uvec2));
-    ui.n_vertices += ui.n_pixels;
+    memcpy(ui->data.vertices + ui->n_vertices, ui->data.pixels, ui->n_pixels * sizeof(uvec2));
+    ui->n_vertices += ui->n_pixels;
+    ui->cached = 1;
+    return 0;
+}
 
-    return ui_render();
+int ui_display(struct ui *ui)
+{
+    gl_restore_state(ui);
+    check_gl(LINEFILESTR);
+    if (ui_build(ui) < 0)
+        return -1;
+    return ui_render(ui);
 }
 
 static int rect_contains(urect *rect, int x, int y){
@@ -292,55 +843,98 @@ static int rect_contains(urect *rect, int x, int y){
     
 }
 
-int ui_handle_event(const char *event, int ui_id){
-    int callback_id = ui.ui_elems[ui_id].head.callback_id;
+int ui_handle_event(struct ui *ui, const char *event, int ui_id){
+    int callback_id = ui->ui_elems[ui_id].head.callback_id;
     struct callback_info *cb_inf;
     while (callback_id >= 0){
-        cb_inf = &ui.cb[callback_id];
+        cb_inf = &ui->cb[callback_id];
         if (cb_inf->event && (strcmp(event, cb_inf->event) == 0)){
-            cb_inf->cb(NULL);
+            cb_inf->cb(ui->user);
             return 0;
         }
         callback_id = cb_inf->next;
     }
-    ui.last_error = "didnt find event";
+    ui->last_error = "didnt find event";
     return -1;
 }
 
-int ui_event(const char *event, int x, int y)
+//one pass over the elements for all points, first element containing a
+//point wins like in ui_event. returns how many points hit something
+int ui_hit_test(struct ui *ui, const int *xy, int n, int *hits)
 {
-    int s;
-    for (int i=0; i<ui.n_ui; i++){
-        switch(ui.ui_elems[i].head.type){
-            case UI_BUTTON:
-                if (rect_contains( &((struct ui_button *) &ui.ui_elems[i])->rect, x, y)){
-                    s = ui_handle_event(event, i);
-                    if (s < 0)
-                        return s;
-                    return i;
-                }
-            break;
-            default:
-                ui.last_error = "unknown ui element type.";
-                return -2;
-            break;
+    int found = 0;
+    for (int i=0; i<n; i++)
+        hits[i] = -1;
+    for (int i=0; i<ui->n_ui && found < n; i++){
+        if (ui->ui_elems[i].head.type != UI_BUTTON)
+            continue;
+        struct ui_button *b = (struct ui_button *) &ui->ui_elems[i];
+        for (int j=0; j<n; j++){
+            int x = xy[j * 2], y = xy[j * 2 + 1];
+            if (hits[j] < 0 && rect_contains(&b->rect, x, y) &&
+                (!b->clipped || clip_contains(&b->clip, x, y)))
+            {
+                hits[j] = i;
+                found++;
+            }
         }
     }
-    return -1;
+    return found;
+}
 
+int ui_event(struct ui *ui, const char *event, int x, int y)
+{
+    int hit;
+    ui_hit_test(ui, (int[2]){x, y}, 1, &hit);
+    if (hit < 0)
+        return -1;
+    int s = ui_handle_event(ui, event, hit);
+    if (s < 0)
+        return s;
+    return hit;
+}
+void ui_free(struct ui *ui)
+{
+    if (ui->vbo)
+        glDeleteBuffers(1, &ui->vbo);
+    if (ui->vao)
+        glDeleteVertexArrays(1, &ui->vao);
+    if (ui->prg)
+        glDeleteProgram(ui->prg);
+    ui->vbo = ui->vao = ui->prg = 0;
+    if (ui->sdf_gl.prg){
+        glDeleteBuffers(1, &ui->sdf_gl.vbo);
+        glDeleteVertexArrays(1, &ui->sdf_gl.vao);
+        glDeleteTextures(1, &ui->sdf_gl.tex);
+        glDeleteProgram(ui->sdf_gl.prg);
+    }
+    memset(&ui->sdf_gl, 0, sizeof ui->sdf_gl);
+    sdf_free(&ui->sdf);
+    free(ui->font.glyphs);
+    free(ui->font.px);
+    memset(&ui->font, 0, sizeof ui->font);
+}
+void ui_flush(struct ui *ui)
+{
+    ui->n_clips = 0;
+    ui->n_quads = 0;
+    ui->n_pixels = 0;
+    ui->n_rects = 0;
+    ui->n_vertices = 0;
+    ui->cached = 0;
 }
-void ui_flush()
+void ui_clear(struct ui *ui)
 {
-    ui.n_pixels = 0;
-    ui.n_rects = 0;
-    ui.n_vertices = 0;
-    ui.cached = 0;
+    ui_flush(ui);
+    ui->n_ui = 0;
+    ui->n_cb = 0;
+    ui->bloblen = 0;
 }
-int ui_create_button(int x, int y, int w, int h, const char *label)
+int ui_create_button(struct ui *ui, int x, int y, int w, int h, const char *label)
 {
-    if (ui.n_ui >= UI_MAX)
+    if (ui->n_ui >= UI_MAX)
         return -1;
-    struct ui_button *button = (struct ui_button *) &ui.ui_elems[ui.n_ui];
+    struct ui_button *button = (struct ui_button *) &ui->ui_elems[ui->n_ui];
     set_color(button->rect.rgb, COLOR_HBLACK);
     set_color(button->text_color, COLOR_WHITE);
     button->rect.x = x;
@@ -348,38 +942,41 @@ int ui_create_button(int x, int y, int w, int h, const char *label)
     button->rect.w = w;
     button->rect.h = h;
     uint16_t len = strlen(label);
-    button->text = copy_to_blob(label, len);
+    button->text = copy_to_blob(ui, label, len);
     button->textlen = len;
     button->head.callback_id = -1;
     button->head.type = UI_BUTTON;
-    return ui.n_ui++;
+    button->layout = NULL;
+    button->clip = clip_top(ui);
+    button->clipped = ui->n_clips > 0;
+    return ui->n_ui++;
 }
 
-int ui_register_callback(int element_id, const char *event, cb_func func)
+int ui_register_callback(struct ui *ui, int element_id, const char *event, cb_func func)
 {
-    if (ui.n_cb >= CB_MAX || element_id < 0 || element_id > ui.n_ui){
-        ui.last_error = "ui.n_cb+1 >= CB_MAX";
+    if (ui->n_cb >= CB_MAX || element_id < 0 || element_id > ui->n_ui){
+        ui->last_error = "ui.n_cb+1 >= CB_MAX";
         return -1;
     }
-    const char *event_str = copy_to_blob(event, strlen(event));
+    const char *event_str = copy_to_blob(ui, event, strlen(event));
     if (!event_str){
-        ui.last_error = "strblob full";
+        ui->last_error = "strblob full";
         return -1;
     }
-    struct callback_info *new_cb = &ui.cb[ui.n_cb];
+    struct callback_info *new_cb = &ui->cb[ui->n_cb];
     new_cb->event = event_str;
     new_cb->cb = func;
-    ui_element *target = &ui.ui_elems[element_id];
+    ui_element *target = &ui->ui_elems[element_id];
     //link new cb to prev cb (can be -1)
     new_cb->next = target->head.callback_id;
     //link ui_element to new cb
-    target->head.callback_id = ui.n_cb;
-    return ui.n_cb++;
+    target->head.callback_id = ui->n_cb;
+    return ui->n_cb++;
 }
 
-const char *ui_last_error(void){
-    if (!ui.last_error)
-        ui.last_error = "";
-    return ui.last_error;
+const char *ui_last_error(struct ui *ui){
+    if (!ui->last_error)
+        ui->last_error = "";
+    return ui->last_error;
 }
 
@@ -2,6 +2,8 @@
 #define UI_H
 
 #include "lin.h"
+#include "camera.h"
+#include "sdf.h"
 
 struct ui_head;
 #define PIX_MAX         100000 //700kb
@@ -10,6 +12,8 @@ struct ui_head;
 #define UI_MAX          100  
 #define STR_BLOB_MAX    10000   //10kb
 #define UI_V_MAX        200000 //1400kb
+#define UI_QUAD_MAX     4096   //scaled glyphs, 500kb
+#define UI_CLIP_MAX     16
 
 #define COLOR_WHITE     0xFFFFFFFF
 #define COLOR_HBLACK    0x00000088
@@ -27,6 +31,18 @@ typedef struct {
     uint8_t  rgb[4];
 } urect;
 
+//scaled text, 6 per glyph quad. x y in screen pixels, u v in atlas texels
+struct ui_quad_vertex{
+    float x, y;
+    float u, v;
+    uint8_t rgb[4];
+};
+
+//[x0, x1) x [y0, y1) in screen pixels
+struct ui_clip{
+    int x0, y0, x1, y1;
+};
+
 enum ui_type{
     UI_BUTTON,
     UI_LABEL,
@@ -46,12 +62,17 @@ struct callback_info{
     int next;
 };
 
+struct ui_text;
 struct ui_button{
     struct ui_head head;
     urect rect;
     const char *text; //ptr to somewhere in strblob
     uint16_t textlen;
     uint8_t text_color[4];
+    const struct ui_text *layout; //in ui->text while layout_gen is current
+    uint64_t layout_gen;
+    struct ui_clip clip; //the clip it was created in, for drawing and hit tests
+    uint8_t clipped;     //0 when created outside any clip
 };
 
 struct ui_label{
@@ -60,6 +81,56 @@ struct ui_label{
     const char *text; //ptr to somewhere in strblob
 };
 
+struct pfont;
+
+//where a glyph's set pixels are in ui_font.px, at is UI_GLYPH_UNSET until
+//the glyph is first drawn
+#define UI_GLYPH_UNSET  UINT32_MAX
+struct ui_glyph_px{
+    uint32_t at, n;
+};
+
+//set pixels of the glyphs drawn so far, expanded once from the packed font
+struct ui_font{
+    const struct pfont *src; //pfont_builtin() unless ui_set_font() chose one
+    struct ui_glyph_px *glyphs; //src->hdr->n_glyphs
+    uint64_t *px;            //uvec2 bits, x and y offsets, no color
+    size_t n_px, cap_px;
+};
+
+#define UI_TEXT_SLOTS   256      //power of 2
+#define UI_TEXT_GLYPHS  8192
+#define UI_TEXT_BLOB    8192
+
+struct ui_glyph_pos{
+    uint16_t glyph;         //index into the font
+    uint16_t x;             //from the left edge of the text
+};
+
+//a laid out string, glyphs placed relative to its top left corner
+struct ui_text{
+    char used;
+    uint16_t len;
+    uint16_t width, height;
+    uint32_t hash;
+    const struct pfont *font;
+    int key;                //the string, at blob + key
+    int first, count;       //its glyphs, glyphs[first .. first + count)
+    int n_pixels;           //what replaying it emits
+};
+
+//layouts by (string, font), replayed with a translation and a color.
+//flushed whole when full
+struct ui_text_cache{
+    struct ui_text slots[UI_TEXT_SLOTS]; //open addressing
+    int n, n_glyphs, n_blob;
+    struct ui_glyph_pos glyphs[UI_TEXT_GLYPHS];
+    char blob[UI_TEXT_BLOB];
+    struct {
+        uint64_t hits, misses, flushes;
+    } stats;
+};
+
 union ui_element{
     struct ui_head head;
     struct ui_button _;
@@ -75,6 +146,8 @@ struct ui{
     GLuint umat_loc;
     int screen_width;
     int screen_height;
+    struct camera cam;
+    unsigned cam_version; //camera version last uploaded to u_mat
     char cached;
     int n_ui;
     int n_cb;
@@ -83,6 +156,8 @@ struct ui{
     int n_rects;
     int bloblen;
     int first_point_vertex; //whats before it is rectangles
+    int draw_calls;         //by the last ui_render()
+    size_t upload_bytes;
 
     ui_element ui_elems[UI_MAX];
     struct callback_info cb[CB_MAX];
@@ -91,20 +166,74 @@ struct ui{
         uvec2 pixels[PIX_MAX];
         char strblob[STR_BLOB_MAX];
         uvec2 vertices[UI_V_MAX];
+        struct ui_quad_vertex quads[UI_QUAD_MAX * 6];
     } data;
+    int n_quads;
+    struct ui_clip clips[UI_CLIP_MAX]; //each inside the one below, the screen under all
+    int n_clips;
+    struct ui_font font;
+    struct ui_text_cache text;
+    struct sdf_atlas sdf;   //of font.src, built by the first ui_draw_text_scaled()
+    struct {
+        GLuint prg, vao, vbo, tex;
+        GLuint umat_loc, uatlas_loc;
+        unsigned cam_version;
+        char uploaded;      //tex holds sdf
+    } sdf_gl;
     const char *last_error;
+    void *user;             //passed to every callback
 };
 
-
-int ui_display(void);
-int ui_initialize();
-void ui_set_screen_dim(uint16_t w, uint16_t h);
-int ui_create_button(int x, int y, int w, int h, const char *label);
-int ui_put_pixel(uint16_t x, uint16_t y, uint32_t color);
-int ui_put_pixel_rgb_array(uint16_t x, uint16_t y, uint8_t rgb[4]);
-int ui_register_callback(int element_id, const char *event, cb_func func);
-const char *ui_last_error(void);
-void ui_flush();
-int ui_event(const char *event, int x, int y);
+/*
+ * all state is in struct ui, zero it before use. ui_initialize() only for
+ * drawing through GL with ui_display(), ui_build() alone needs no context.
+ */
+int ui_initialize(struct ui *ui);
+void ui_free(struct ui *ui);
+int ui_display(struct ui *ui);
+int ui_build(struct ui *ui);
+void ui_set_screen_dim(struct ui *ui, uint16_t w, uint16_t h);
+int ui_create_button(struct ui *ui, int x, int y, int w, int h, const char *label);
+/*
+ * everything drawn is cut to the innermost clip rect, the screen when none
+ * is pushed. what falls fully outside emits nothing and is not an error:
+ * no pixels for text and no glyph lookups for cached labels. rects and quads
+ * are cut to the clip, text keeps the pixels inside it. done on the cpu,
+ * so the whole ui stays one batch whatever the clips.
+ * buttons keep the clip they were created in: ui_build() draws them with
+ * it whatever is pushed then, and points outside it do not hit them.
+ */
+//(x, y, w, h) cut to the current clip, until the matching ui_pop_clip()
+int ui_push_clip(struct ui *ui, int x, int y, int w, int h);
+int ui_pop_clip(struct ui *ui);
+//return the pixel or rect index, or 0 when clipped away
+int ui_put_pixel(struct ui *ui, uint16_t x, uint16_t y, uint32_t color);
+int ui_put_pixel_rgb_array(struct ui *ui, uint16_t x, uint16_t y, uint8_t rgb[4]);
+int ui_put_pixels(struct ui *ui, const uvec2 *px, int n);
+int ui_put_rect(struct ui *ui, urect *rect);
+//utf-8, the font's height high and ui_measure_text() wide. -1 past the 16
+//bit coordinate range
+int ui_draw_text(struct ui *ui, uint16_t x, uint16_t y, const char *text, uint8_t rgb[4]);
+//scale times the font's size, one textured quad per glyph whatever the
+//scale. GL only, swr_draw_ui() does not draw them
+int ui_draw_text_scaled(struct ui *ui, uint16_t x, uint16_t y, float scale, const char *text, uint8_t rgb[4]);
+//the same pixels, through the layout cache. for text that repeats
+int ui_draw_label(struct ui *ui, uint16_t x, uint16_t y, const char *text, uint8_t rgb[4]);
+uint16_t ui_measure_text(struct ui *ui, const char *text);
+//fixed width of len glyphs of the builtin font, ui_measure_text() for a string
+uint16_t ui_textwidth(int len);
+//font must outlive the ui or the next ui_set_font(). drops cached layouts
+int ui_set_font(struct ui *ui, const struct pfont *font);
+int ui_register_callback(struct ui *ui, int element_id, const char *event, cb_func func);
+const char *ui_last_error(struct ui *ui);
+//drops what was drawn and any clips left pushed
+void ui_flush(struct ui *ui);
+//drops every element and callback
+void ui_clear(struct ui *ui);
+int ui_event(struct ui *ui, const char *event, int x, int y);
+//hits[i] is the element under point (xy[2i], xy[2i+1]), or -1
+int ui_hit_test(struct ui *ui, const int *xy, int n, int *hits);
+//runs the callback of element ui_id registered for event
+int ui_handle_event(struct ui *ui, const char *event, int ui_id);
 
 #endif
@@ -0,0 +1,208 @@
+#include "common.h"
+#include "xform.h"
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+int xform_init(struct xform_set *xs, int cap)
+{
+    memset(xs, 0, sizeof *xs);
+    float *f = malloc(sizeof(float) * 10 * cap);
+    xs->parent  = malloc(sizeof(int) * cap);
+    xs->scratch = malloc(sizeof(int) * cap);
+    xs->dirty   = malloc(cap);
+    xs->local   = malloc(sizeof(mat4x4) * cap);
+    xs->world   = malloc(sizeof(mat4x4) * cap);
+    if (!f || !xs->parent || !xs->scratch || !xs->dirty || !xs->local || !xs->world){
+        free(f);
+        xform_free(xs);
+        return -1;
+    }
+    xs->px = f;          xs->py = f + cap;     xs->pz = f + cap * 2;
+    xs->qx = f + cap * 3; xs->qy = f + cap * 4; xs->qz = f + cap * 5; xs->qw = f + cap * 6;
+    xs->sx = f + cap * 7; xs->sy = f + cap * 8; xs->sz = f + cap * 9;
+    xs->cap = cap;
+    return 0;
+}
+
+void xform_free(struct xform_set *xs)
+{
+    free(xs->px); //owns all the float arrays
+    free(xs->parent);
+    free(xs->scratch);
+    free(xs->dirty);
+    free(xs->local);
+    free(xs->world);
+    memset(xs, 0, sizeof *xs);
+}
+
+int xform_add(struct xform_set *xs, int parent)
+{
+    if (xs->count >= xs->cap || parent >= xs->count)
+        return -1;
+    int id = xs->count++;
+    xs->px[id] = xs->py[id] = xs->pz[id] = 0.0f;
+    xs->qx[id] = xs->qy[id] = xs->qz[id] = 0.0f;
+    xs->qw[id] = 1.0f;
+    xs->sx[id] = xs->sy[id] = xs->sz[id] = 1.0f;
+    xs->parent[id] = parent < 0 ? -1 : parent;
+    xs->dirty[id] = 1;
+    return id;
+}
+
+void xform_set_position(struct xform_set *xs, int id, float x, float y, float z)
+{
+    xs->px[id] = x;
+    xs->py[id] = y;
+    xs->pz[id] = z;
+    xs->dirty[id] = 1;
+}
+
+void xform_set_rotation(struct xform_set *xs, int id, quat q)
+{
+    xs->qx[id] = q[0];
+    xs->qy[id] = q[1];
+    xs->qz[id] = q[2];
+    xs->qw[id] = q[3];
+    xs->dirty[id] = 1;
+}
+
+void xform_rotate(struct xform_set *xs, int id, quat q)
+{
+    quat cur = { xs->qx[id], xs->qy[id], xs->qz[id], xs->qw[id] };
+    quat r;
+    quat_mul(r, q, cur);
+    xform_set_rotation(xs, id, r);
+}
+
+void xform_set_scale(struct xform_set *xs, int id, float x, float y, float z)
+{
+    xs->sx[id] = x;
+    xs->sy[id] = y;
+    xs->sz[id] = z;
+    xs->dirty[id] = 1;
+}
+
+//same expansion as mat4x4_from_quat, scaled per column and translated
+static void local_one(struct xform_set *xs, int i)
+{
+    float a = xs->qw[i], b = xs->qx[i], c = xs->qy[i], d = xs->qz[i];
+    float a2 = a * a, b2 = b * b, c2 = c * c, d2 = d * d;
+    float *M = &xs->local[i][0][0];
+
+    M[0]  = (a2 + b2 - c2 - d2) * xs->sx[i];
+    M[1]  = 2.0f * (b * c + a * d) * xs->sx[i];
+    M[2]  = 2.0f * (b * d - a * c) * xs->sx[i];
+    M[3]  = 0.0f;
+    M[4]  = 2.0f * (b * c - a * d) * xs->sy[i];
+    M[5]  = (a2 - b2 + c2 - d2) * xs->sy[i];
+    M[6]  = 2.0f * (c * d + a * b) * xs->sy[i];
+    M[7]  = 0.0f;
+    M[8]  = 2.0f * (b * d + a * c) * xs->sz[i];
+    M[9]  = 2.0f * (c * d - a * b) * xs->sz[i];
+    M[10] = (a2 - b2 - c2 + d2) * xs->sz[i];
+    M[11] = 0.0f;
+    M[12] = xs->px[i];
+    M[13] = xs->py[i];
+    M[14] = xs->pz[i];
+    M[15] = 1.0f;
+}
+
+#ifdef __SSE__
+#define GATHER(arr, ids) _mm_setr_ps((arr)[ids[0]], (arr)[ids[1]], (arr)[ids[2]], (arr)[ids[3]])
+
+//4 local matrices at once, one lane per object
+static void local_four(struct xform_set *xs, const int *ids)
+{
+    __m128 two = _mm_set1_ps(2.0f);
+    __m128 a = GATHER(xs->qw, ids), b = GATHER(xs->qx, ids);
+    __m128 c = GATHER(xs->qy, ids), d = GATHER(xs->qz, ids);
+    __m128 sx = GATHER(xs->sx, ids), sy = GATHER(xs->sy, ids), sz = GATHER(xs->sz, ids);
+    __m128 a2 = _mm_mul_ps(a, a), b2 = _mm_mul_ps(b, b);
+    __m128 c2 = _mm_mul_ps(c, c), d2 = _mm_mul_ps(d, d);
+    __m128 bc = _mm_mul_ps(b, c), ad = _mm_mul_ps(a, d);
+    __m128 bd = _mm_mul_ps(b, d), ac = _mm_mul_ps(a, c);
+    __m128 cd = _mm_mul_ps(c, d), ab = _mm_mul_ps(a, b);
+
+    __m128 m[12];
+    m[0]  = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(a2, b2), _mm_add_ps(c2, d2)), sx);
+    m[1]  = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(bc, ad)), sx);
+    m[2]  = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(bd, ac)), sx);
+    m[3]  = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(bc, ad)), sy);
+    m[4]  = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(a2, c2), _mm_add_ps(b2, d2)), sy);
+    m[5]  = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(cd, ab)), sy);
+    m[6]  = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(bd, ac)), sz);
+    m[7]  = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(cd, ab)), sz);
+    m[8]  = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(a2, d2), _mm_add_ps(b2, c2)), sz);
+    m[9]  = GATHER(xs->px, ids);
+    m[10] = GATHER(xs->py, ids);
+    m[11] = GATHER(xs->pz, ids);
+
+    //transpose lanes back out to one matrix per object
+    float out[12][4];
+    for (int k = 0; k < 12; k++)
+        _mm_storeu_ps(out[k], m[k]);
+    for (int l = 0; l < 4; l++){
+        float *M = &xs->local[ids[l]][0][0];
+        M[0] = out[0][l]; M[1]  = out[1][l];  M[2]  = out[2][l];  M[3]  = 0.0f;
+        M[4] = out[3][l]; M[5]  = out[4][l];  M[6]  = out[5][l];  M[7]  = 0.0f;
+        M[8] = out[6][l]; M[9]  = out[7][l];  M[10] = out[8][l];  M[11] = 0.0f;
+        M[12] = out[9][l]; M[13] = out[10][l]; M[14] = out[11][l]; M[15] = 1.0f;
+    }
+}
+#undef GATHER
+
+static void mul_world(mat4x4 R, mat4x4 P, mat4x4 L)
+{
+    __m128 p0 = _mm_loadu_ps(P[0]), p1 = _mm_loadu_ps(P[1]);
+    __m128 p2 = _mm_loadu_ps(P[2]), p3 = _mm_loadu_ps(P[3]);
+    for (int c = 0; c < 4; c++){
+        __m128 r = _mm_mul_ps(p0, _mm_set1_ps(L[c][0]));
+        r = _mm_add_ps(r, _mm_mul_ps(p1, _mm_set1_ps(L[c][1])));
+        r = _mm_add_ps(r, _mm_mul_ps(p2, _mm_set1_ps(L[c][2])));
+        r = _mm_add_ps(r, _mm_mul_ps(p3, _mm_set1_ps(L[c][3])));
+        _mm_storeu_ps(R[c], r);
+    }
+}
+#else
+static void local_four(struct xform_set *xs, const int *ids)
+{
+    for (int l = 0; l < 4; l++)
+        local_one(xs, ids[l]);
+}
+
+static void mul_world(mat4x4 R, mat4x4 P, mat4x4 L)
+{
+    mat4x4_mul(R, P, L);
+}
+#endif
+
+int xform_update(struct xform_set *xs)
+{
+    int n_dirty = 0;
+    //parents come first, so one pass pushes dirtiness down whole subtrees
+    for (int i = 0; i < xs->count; i++){
+        int p = xs->parent[i];
+        if (p >= 0 && xs->dirty[p])
+            xs->dirty[i] = 1;
+        if (xs->dirty[i])
+            xs->scratch[n_dirty++] = i;
+    }
+
+    int i = 0;
+    for (; i + 4 <= n_dirty; i += 4)
+        local_four(xs, xs->scratch + i);
+    for (; i < n_dirty; i++)
+        local_one(xs, xs->scratch[i]);
+
+    for (i = 0; i < n_dirty; i++){
+        int id = xs->scratch[i];
+        int p = xs->parent[id];
+        if (p < 0)
+            mat4x4_dup(xs->world[id], xs->local[id]);
+        else
+            mul_world(xs->world[id], xs->world[p], xs->local[id]);
+        xs->dirty[id] = 0;
+    }
+    return n_dirty;
+}
@@ -0,0 +1,41 @@
+#ifndef XFORM_H
+#define XFORM_H
+
+#include <stdint.h>
+#include "lin.h"
+
+/*
+ * transform hierarchy for many objects.
+ * position, rotation and scale live in SoA arrays so world matrices can
+ * be rebuilt 4 objects at a time. a node's parent always has a lower
+ * index, so one forward pass propagates dirty flags and another one
+ * composes world matrices; clean subtrees are skipped entirely.
+ */
+
+struct xform_set{
+    int count;
+    int cap;
+
+    float *px, *py, *pz;
+    float *qx, *qy, *qz, *qw;
+    float *sx, *sy, *sz;
+    int *parent;    //-1 for roots
+    uint8_t *dirty;
+
+    mat4x4 *local;
+    mat4x4 *world;
+    int *scratch;   //dirty list, rebuilt by xform_update()
+};
+
+int  xform_init(struct xform_set *xs, int cap);
+void xform_free(struct xform_set *xs);
+//returns the new node id or -1 if full / parent is invalid
+int  xform_add(struct xform_set *xs, int parent);
+void xform_set_position(struct xform_set *xs, int id, float x, float y, float z);
+void xform_set_rotation(struct xform_set *xs, int id, quat q);
+void xform_rotate(struct xform_set *xs, int id, quat q); //q * current
+void xform_set_scale(struct xform_set *xs, int id, float x, float y, float z);
+//recomputes world matrices of dirty nodes and their subtrees, returns how many
+int  xform_update(struct xform_set *xs);
+
+#endif